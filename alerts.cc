@@ -0,0 +1,165 @@
+/// @file alerts.cc
+/// @brief alert state kept between runs
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "alerts.h"
+#include "therm.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace therm
+{
+
+/// @brief the start of the state file
+struct alert_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t records;
+    uint32_t reserved;
+};
+
+uint64_t get_alert_key (const std::string &name)
+{
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    for (auto c : name)
+    {
+        h ^= static_cast<unsigned char> (c);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static bool operator< (const alert_record &a, const alert_record &b)
+{
+    return a.key < b.key;
+}
+
+static bool operator== (const alert_record &a, const alert_record &b)
+{
+    return a.key == b.key
+        && a.since == b.since
+        && a.last_alert == b.last_alert
+        && a.state == b.state
+        && a.escalated == b.escalated;
+}
+
+alert_state::alert_state (const std::string &fn, uint64_t renotify, uint64_t escalate)
+    : fn (fn)
+    , renotify (renotify)
+    , escalate (escalate)
+{
+    const int fd = open (fn.c_str (), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return;
+    struct stat st;
+    void *p = MAP_FAILED;
+    if (fstat (fd, &st) == 0 && size_t (st.st_size) >= sizeof (alert_header))
+        p = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (p == MAP_FAILED)
+        return;
+    const alert_header *h = static_cast<const alert_header *> (p);
+    const alert_record *r = reinterpret_cast<const alert_record *> (h + 1);
+    // ignore a state file of another version, or one that was cut short
+    if (h->magic == ALERT_MAGIC && h->version == ALERT_VERSION
+        && sizeof (alert_header) + h->records * sizeof (alert_record) == size_t (st.st_size))
+        old_records.assign (r, r + h->records);
+    munmap (p, st.st_size);
+    std::sort (old_records.begin (), old_records.end ());
+}
+
+alert_notice alert_state::update (uint64_t key, int state, uint64_t time)
+{
+    alert_record r { key, 0, 0, NORMAL, 0 };
+    auto i = std::lower_bound (old_records.begin (), old_records.end (), r);
+    if (i != old_records.end () && i->key == key)
+        r = *i;
+    const uint32_t previous = r.state;
+    r.state = state;
+    alert_notice notice = NOTICE_NONE;
+    if (state == NORMAL)
+    {
+        if (previous != NORMAL)
+            notice = NOTICE_RECOVERED;
+        r.since = r.last_alert = r.escalated = 0;
+    }
+    else
+    {
+        if (previous == NORMAL)
+            r.since = time;
+        const bool escalated = state == HIGH && escalate && !r.escalated && time >= r.since + escalate;
+        // something new, something worse, or something that was reported
+        // long enough ago
+        if (previous == NORMAL
+            || uint32_t (state) > previous
+            || escalated
+            || !renotify
+            || time >= r.last_alert + renotify)
+        {
+            r.escalated = r.escalated || escalated;
+            notice = state == CRITICAL || r.escalated ? NOTICE_CRITICAL : NOTICE_HIGH;
+            r.last_alert = time;
+        }
+    }
+    // normal sensors are only remembered so they aren't reported twice
+    if (r.state != NORMAL)
+        records.push_back (r);
+    return notice;
+}
+
+void alert_state::save ()
+{
+    std::sort (records.begin (), records.end ());
+    if (records == old_records)
+        return;
+    if (records.empty ())
+    {
+        unlink (fn.c_str ());
+        old_records.clear ();
+        return;
+    }
+    const std::string tmp = fn + "." + std::to_string (getpid ()) + ".tmp";
+    const int fd = open (tmp.c_str (), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1)
+        throw std::runtime_error ("could not open " + tmp);
+    alert_header h { ALERT_MAGIC, ALERT_VERSION, uint32_t (records.size ()), 0 };
+    const size_t n = records.size () * sizeof (alert_record);
+    const bool ok = write (fd, &h, sizeof (h)) == sizeof (h)
+        && write (fd, &records[0], n) == ssize_t (n);
+    close (fd);
+    if (!ok)
+    {
+        unlink (tmp.c_str ());
+        throw std::runtime_error ("could not write " + tmp);
+    }
+    if (rename (tmp.c_str (), fn.c_str ()))
+        throw std::runtime_error ("could not rename " + tmp + " to " + fn);
+    old_records = records;
+}
+
+} // namespace therm
@@ -0,0 +1,114 @@
+/// @file alerts.h
+/// @brief alert state kept between runs
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef ALERTS_H
+#define ALERTS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief alert state file identification
+const uint32_t ALERT_MAGIC = 0x74686174;
+const uint32_t ALERT_VERSION = 1;
+
+/// @brief what to tell the user about a sensor or a rule
+enum alert_notice
+{
+    NOTICE_NONE,
+    NOTICE_HIGH,
+    NOTICE_CRITICAL,
+    NOTICE_RECOVERED
+};
+
+/// @brief the alert state of a sensor or a rule in the state file
+struct alert_record
+{
+    /// @brief hash of the sensor's or the rule's name
+    uint64_t key;
+    /// @brief time in ms since the epoch that it left the normal state
+    uint64_t since;
+    /// @brief time in ms since the epoch of the last notice
+    uint64_t last_alert;
+    /// @brief its status in the last run
+    uint32_t state;
+    /// @brief true once it has been high long enough to escalate
+    uint32_t escalated;
+};
+
+/// @brief get the key of a sensor or a rule
+///
+/// @param name a name that identifies it
+///
+/// @return the key
+uint64_t get_alert_key (const std::string &name);
+
+/// @brief alert state kept between runs
+///
+/// When thermalert is run from cron, this remembers which sensors and rules
+/// were already alerted about, so that a host that stays hot is reported
+/// again only every re-notify interval, a sensor that stays high long enough
+/// is escalated to critical, and a sensor that cools down is reported as
+/// recovered.
+///
+/// The state file is a small header followed by the records sorted by key.
+/// It is mapped and copied when the state is constructed, and if anything
+/// changed, save () writes a new one and renames it over the old one, so a
+/// run that is killed never leaves a partial file.
+class alert_state
+{
+    public:
+    /// @brief constructor
+    ///
+    /// A missing or unreadable state file is the same as an empty one.
+    ///
+    /// @param fn state filename
+    /// @param renotify ms between notices for something that stays hot, or
+    /// 0 to notify every run
+    /// @param escalate ms that a sensor stays high before it is treated as
+    /// critical, or 0 to never escalate
+    alert_state (const std::string &fn, uint64_t renotify, uint64_t escalate);
+    /// @brief update the state of a sensor or a rule
+    ///
+    /// @param key its key
+    /// @param state its status, NORMAL, HIGH or CRITICAL
+    /// @param time time of the run in ms since the epoch
+    ///
+    /// @return what to tell the user
+    alert_notice update (uint64_t key, int state, uint64_t time);
+    /// @brief write the state file if the state changed
+    ///
+    /// Sensors and rules that were not updated in this run are forgotten.
+    void save ();
+    private:
+    std::string fn;
+    uint64_t renotify;
+    uint64_t escalate;
+    /// @brief records of the previous run, sorted by key, and of this run
+    std::vector<alert_record> old_records, records;
+};
+
+} // namespace therm
+
+#endif
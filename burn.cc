@@ -0,0 +1,346 @@
+/// @file burn.cc
+/// @brief cooling capacity benchmark
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "burn.h"
+#include "powercap.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace therm
+{
+
+std::vector<int> parse_cpus (const std::string &s)
+{
+    std::vector<int> cpus;
+    // the cpus this process may run on, which leaves out offline ones
+    cpu_set_t allowed;
+    if (sched_getaffinity (0, sizeof (allowed), &allowed) == -1)
+        throw std::runtime_error ("could not get the cpus to run on");
+    if (s.empty ())
+    {
+        for (int i = 0; i < CPU_SETSIZE; ++i)
+            if (CPU_ISSET (i, &allowed))
+                cpus.push_back (i);
+        return cpus;
+    }
+    std::istringstream ss (s);
+    std::string range;
+    while (std::getline (ss, range, ','))
+    {
+        int first, last;
+        char c;
+        std::istringstream rs (range);
+        if (!(rs >> first))
+            throw std::runtime_error ("invalid cpu list '" + s + "'");
+        last = first;
+        if (rs >> c && (c != '-' || !(rs >> last) || last < first))
+            throw std::runtime_error ("invalid cpu list '" + s + "'");
+        for (int i = first; i <= last; ++i)
+        {
+            if (i < 0 || i >= CPU_SETSIZE || !CPU_ISSET (i, &allowed))
+                throw std::runtime_error ("cpu " + std::to_string (i) + " is not online");
+            cpus.push_back (i);
+        }
+    }
+    return cpus;
+}
+
+std::vector<double> parse_levels (const std::string &s)
+{
+    std::vector<double> levels;
+    std::istringstream ss (s);
+    std::string level;
+    while (std::getline (ss, level, ','))
+    {
+        char *end;
+        const double x = strtod (level.c_str (), &end);
+        if (end == level.c_str () || *end || x < 0 || x > 100)
+            throw std::runtime_error ("invalid load levels '" + s + "'");
+        levels.push_back (x);
+    }
+    if (levels.empty ())
+        throw std::runtime_error ("no load levels");
+    return levels;
+}
+
+load_generator::load_generator (const std::vector<int> &cpus)
+    : level (0)
+    , done (false)
+{
+    for (auto cpu : cpus)
+    {
+        // pin each thread before it runs, so no load lands on another cpu
+        cpu_set_t set;
+        CPU_ZERO (&set);
+        CPU_SET (cpu, &set);
+        pthread_attr_t attr;
+        pthread_attr_init (&attr);
+        pthread_t t;
+        int err = pthread_attr_setaffinity_np (&attr, sizeof (set), &set);
+        if (!err)
+            err = pthread_create (&t, &attr, &load_generator::start_run, this);
+        pthread_attr_destroy (&attr);
+        if (err)
+        {
+            stop ();
+            throw std::runtime_error ("could not start a load thread on cpu " + std::to_string (cpu) + ": " + strerror (err));
+        }
+        threads.push_back (t);
+    }
+}
+
+load_generator::~load_generator ()
+{
+    stop ();
+}
+
+void *load_generator::start_run (void *p)
+{
+    static_cast<load_generator *> (p)->run ();
+    return nullptr;
+}
+
+void load_generator::stop ()
+{
+    done = true;
+    for (auto t : threads)
+        pthread_join (t, nullptr);
+    threads.clear ();
+}
+
+void load_generator::set_level (double percent)
+{
+    level = static_cast<unsigned> (percent * 10);
+}
+
+/// @brief get a monotonic time
+///
+/// @return the time in ns
+static uint64_t now_ns ()
+{
+    timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return uint64_t (ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void load_generator::run ()
+{
+    const uint64_t period = BURN_PERIOD * 1000000ull;
+    volatile double x = 1;
+    while (!done.load (std::memory_order_relaxed))
+    {
+        const uint64_t start = now_ns ();
+        const uint64_t busy = period * level.load (std::memory_order_relaxed) / 1000;
+        while (now_ns () - start < busy)
+            for (int i = 0; i < 1000; ++i)
+                x = x * 1.0000001 + 1e-9;
+        const uint64_t elapsed = now_ns () - start;
+        if (elapsed < period)
+            usleep ((period - elapsed) / 1000);
+    }
+}
+
+void thermal_response::begin_level (double percent)
+{
+    levels.push_back (percent);
+    firsts.push_back (times.size ());
+}
+
+void thermal_response::add (const busses &bs, uint64_t time)
+{
+    if (names.empty ())
+    {
+        temps = fans = 0;
+        for (auto &b : bs)
+            for (auto &c : b.chips)
+                for (auto &t : c.temps)
+                {
+                    names.push_back (c.name + ":" + t.label);
+                    ++temps;
+                }
+        for (auto &b : bs)
+            for (auto &c : b.chips)
+                for (auto &f : c.fan_speeds)
+                {
+                    names.push_back (c.name + ":" + f.label);
+                    ++fans;
+                }
+        names.push_back ("power");
+    }
+    const size_t first = values.size ();
+    double power = 0;
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+        {
+            for (auto &t : c.temps)
+                values.push_back (t.current);
+            // package power, from RAPL
+            if (c.name == POWERCAP_CHIP)
+                for (auto &m : c.measurements)
+                    if (m.kind == POWER && m.current >= 0)
+                        power += m.current;
+        }
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+            for (auto &f : c.fan_speeds)
+                values.push_back (f.current);
+    values.push_back (power);
+    if (values.size () - first != names.size ())
+        throw std::runtime_error ("the sensors changed during the benchmark");
+    times.push_back (time);
+}
+
+void thermal_response::analyze (size_t level, size_t j, double &steady, double &tau) const
+{
+    const size_t width = names.size ();
+    const size_t begin = firsts[level];
+    const size_t end = level + 1 < firsts.size () ? firsts[level + 1] : times.size ();
+    const double nan = std::numeric_limits<double>::quiet_NaN ();
+    steady = tau = nan;
+    if (end == begin)
+        return;
+    double sum = 0;
+    size_t n = 0;
+    for (size_t i = end - (end - begin + 3) / 4; i < end; ++i)
+    {
+        sum += values[i * width + j];
+        ++n;
+    }
+    steady = sum / n;
+    // a change of less than a degree is noise
+    const double start = values[begin * width + j];
+    if (std::fabs (steady - start) < 1)
+        return;
+    const double target = start + 0.632 * (steady - start);
+    for (size_t i = begin; i < end; ++i)
+        if ((steady > start) == (values[i * width + j] >= target))
+        {
+            tau = (times[i] - times[begin]) / 1000.0;
+            return;
+        }
+}
+
+void thermal_response::report (std::ostream &s) const
+{
+    if (times.empty ())
+    {
+        s << "no samples" << std::endl;
+        return;
+    }
+    const size_t width = names.size ();
+    std::vector<double> steadies (levels.size () * width), taus (levels.size () * width);
+    for (size_t k = 0; k < levels.size (); ++k)
+        for (size_t j = 0; j < width; ++j)
+            analyze (k, j, steadies[k * width + j], taus[k * width + j]);
+    char buf[256];
+    for (size_t k = 0; k < levels.size (); ++k)
+    {
+        const double *x = &steadies[k * width];
+        const double *x0 = &steadies[0];
+        const double power = x[width - 1];
+        const double dp = power - x0[width - 1];
+        snprintf (buf, sizeof (buf), "level %.0f%%", levels[k]);
+        s << buf << std::endl;
+        if (power > 0)
+        {
+            snprintf (buf, sizeof (buf), "    power %.0fW", power);
+            s << buf << std::endl;
+        }
+        for (size_t j = 0; j < temps; ++j)
+        {
+            const double steady = x[j];
+            const double tau = taus[k * width + j];
+            int n = snprintf (buf, sizeof (buf), "    %s %.0fC", names[j].c_str (), steady);
+            if (k > 0)
+            {
+                n += snprintf (buf + n, sizeof (buf) - n, " %+.0fC", steady - x0[j]);
+                // degrees per watt, when there is enough extra power to tell
+                if (dp >= 1)
+                    n += snprintf (buf + n, sizeof (buf) - n, " %.2fC/W", (steady - x0[j]) / dp);
+            }
+            if (!std::isnan (tau))
+                n += snprintf (buf + n, sizeof (buf) - n, " tau %.0fs", tau);
+            s << buf << std::endl;
+        }
+        for (size_t j = temps; j < temps + fans; ++j)
+        {
+            int n = snprintf (buf, sizeof (buf), "    %s %.0fRPM", names[j].c_str (), x[j]);
+            if (k > 0)
+                n += snprintf (buf + n, sizeof (buf) - n, " %+.0fRPM", x[j] - x0[j]);
+            s << buf << std::endl;
+        }
+    }
+    // fans that read 0 throughout are empty headers
+    s << "fans that never ramped" << std::endl;
+    for (size_t j = temps; j < temps + fans; ++j)
+    {
+        double lowest = steadies[j], highest = steadies[j];
+        for (size_t k = 0; k < levels.size (); ++k)
+        {
+            lowest = std::min (lowest, steadies[k * width + j]);
+            highest = std::max (highest, steadies[k * width + j]);
+        }
+        if (highest > 0 && highest < lowest * (1 + BURN_MIN_RAMP))
+            s << "    " << names[j] << std::endl;
+    }
+}
+
+void thermal_response::write (const std::string &fn) const
+{
+    if (times.empty ())
+        return;
+    const std::string tmp = fn + "." + std::to_string (getpid ()) + ".tmp";
+    {
+        std::ofstream ofs (tmp.c_str ());
+        if (!ofs)
+            throw std::runtime_error ("could not open " + tmp + " for writing");
+        ofs << "time,load";
+        for (auto &n : names)
+            ofs << ',' << n;
+        ofs << std::endl;
+        const size_t width = names.size ();
+        size_t k = 0;
+        for (size_t i = 0; i < times.size (); ++i)
+        {
+            while (k + 1 < firsts.size () && firsts[k + 1] <= i)
+                ++k;
+            ofs << times[i] - times[0] << ',' << levels[k];
+            for (size_t j = 0; j < width; ++j)
+                ofs << ',' << values[i * width + j];
+            ofs << '\n';
+        }
+        if (!ofs)
+            throw std::runtime_error ("could not write " + tmp);
+    }
+    if (rename (tmp.c_str (), fn.c_str ()) == -1)
+        throw std::runtime_error ("could not rename " + tmp + " to " + fn);
+}
+
+} // namespace therm
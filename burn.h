@@ -0,0 +1,154 @@
+/// @file burn.h
+/// @brief cooling capacity benchmark
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BURN_H
+#define BURN_H
+
+#include "therm.h"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief ms in each on and off cycle of a partial load
+const unsigned BURN_PERIOD = 100;
+
+/// @brief a fan whose speed rose by less than this fraction from the lowest
+/// load to the highest never ramped
+const double BURN_MIN_RAMP = 0.1;
+
+/// @brief parse a list of cpus, like '0-3,8'
+///
+/// @param s the list, or empty for all online cpus
+///
+/// @return the cpus, which must all be online and allowed to this process
+std::vector<int> parse_cpus (const std::string &s);
+
+/// @brief parse a list of load levels, like '0,50,100'
+///
+/// @param s the list
+///
+/// @return the levels in percent
+std::vector<double> parse_levels (const std::string &s);
+
+/// @brief keep some cpus busy
+///
+/// One thread is pinned to each cpu.  At a partial load, each thread spins
+/// for that part of every BURN_PERIOD and sleeps for the rest.
+class load_generator
+{
+    public:
+    /// @brief constructor
+    ///
+    /// The threads start idle.
+    ///
+    /// @param cpus the cpus to load
+    load_generator (const std::vector<int> &cpus);
+    /// @brief destructor
+    ~load_generator ();
+    load_generator (const load_generator &) = delete;
+    load_generator &operator= (const load_generator &) = delete;
+    /// @brief set the load
+    ///
+    /// @param percent the load of each cpu
+    void set_level (double percent);
+    private:
+    /// @brief the load loop
+    void run ();
+    /// @brief pthread entry point
+    ///
+    /// @param p the load generator
+    ///
+    /// @return nullptr
+    static void *start_run (void *p);
+    /// @brief stop and join the threads
+    void stop ();
+    std::vector<pthread_t> threads;
+    /// @brief the load in tenths of a percent
+    std::atomic<unsigned> level;
+    std::atomic<bool> done;
+};
+
+/// @brief the thermal response to steps of load
+///
+/// Snapshots are added for each load level in turn.  The steady state of a
+/// sensor at a level is its average over the last quarter of the level, and
+/// its time constant is how long it took to get 63% of the way from where it
+/// started to its steady state.  Levels should last several time constants.
+class thermal_response
+{
+    public:
+    /// @brief start a load level
+    ///
+    /// @param percent the load
+    void begin_level (double percent);
+    /// @brief add a snapshot to the current level
+    ///
+    /// The topology must not change.
+    ///
+    /// @param bs vector of bus sensor data
+    /// @param time time in ms
+    void add (const busses &bs, uint64_t time);
+    /// @brief check if any snapshots were added
+    ///
+    /// @return true if none were, as when the run is interrupted at once
+    bool empty () const { return times.empty (); }
+    /// @brief write the report
+    ///
+    /// Everything but the names is rounded, so that reports of nodes that
+    /// cool the same way are the same.
+    ///
+    /// @param s the stream
+    void report (std::ostream &s) const;
+    /// @brief write the samples as comma separated values
+    ///
+    /// Nothing is written if there are no samples.
+    ///
+    /// @param fn filename
+    void write (const std::string &fn) const;
+    private:
+    /// @brief the steady state and the time constant of a sensor at a level
+    ///
+    /// @param level the level
+    /// @param j the sensor
+    /// @param steady the steady state
+    /// @param tau the time constant in s, or NaN if it didn't change
+    void analyze (size_t level, size_t j, double &steady, double &tau) const;
+    /// @brief names of the temperatures, then the fans, and then 'power'
+    std::vector<std::string> names;
+    size_t temps;
+    size_t fans;
+    /// @brief the levels, and where their samples start
+    std::vector<double> levels;
+    std::vector<size_t> firsts;
+    /// @brief sample times and values, one row per sample
+    std::vector<uint64_t> times;
+    std::vector<double> values;
+};
+
+} // namespace therm
+
+#endif
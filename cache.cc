@@ -0,0 +1,468 @@
+/// @file cache.cc
+/// @brief sensor topology cache
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "cache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace therm
+{
+
+long long get_mtime (const std::string &fn)
+{
+    struct stat sb;
+    if (stat (fn.c_str (), &sb) == -1)
+        return -1;
+    return sb.st_mtim.tv_sec * 1000000000LL + sb.st_mtim.tv_nsec;
+}
+
+std::string get_boot_id ()
+{
+    std::ifstream ifs ("/proc/sys/kernel/random/boot_id");
+    std::string id;
+    ifs >> id;
+    return id;
+}
+
+std::vector<std::pair<std::string, long long> > get_config_mtimes ()
+{
+    std::vector<std::pair<std::string, long long> > configs;
+    const char *fns[] = { "/etc/sensors3.conf", "/etc/sensors.conf", "/etc/sensors.d" };
+    for (auto fn : fns)
+        configs.push_back (std::make_pair (std::string (fn), get_mtime (fn)));
+    if (DIR *d = opendir ("/etc/sensors.d"))
+    {
+        std::vector<std::string> names;
+        while (dirent *e = readdir (d))
+            if (e->d_name[0] != '.')
+                names.push_back (std::string ("/etc/sensors.d/") + e->d_name);
+        closedir (d);
+        std::sort (names.begin (), names.end ());
+        for (auto fn : names)
+            configs.push_back (std::make_pair (fn, get_mtime (fn)));
+    }
+    return configs;
+}
+
+std::vector<std::string> get_hwmon_devices (const std::string &dir)
+{
+    std::vector<std::string> names;
+    if (DIR *d = opendir (dir.c_str ()))
+    {
+        while (dirent *e = readdir (d))
+            if (e->d_name[0] != '.')
+                names.push_back (e->d_name);
+        closedir (d);
+    }
+    std::sort (names.begin (), names.end ());
+    return names;
+}
+
+bool read_attribute (const std::string &fn, double scale, double &value)
+{
+    if (fn.empty ())
+        return true;
+    const int fd = open (fn.c_str (), O_RDONLY);
+    if (fd == -1)
+        return false;
+    char buf[32];
+    const ssize_t n = ::read (fd, buf, sizeof (buf) - 1);
+    close (fd);
+    if (n <= 0)
+        return false;
+    buf[n] = 0;
+    char *end;
+    const long long raw = strtoll (buf, &end, 10);
+    if (end == buf)
+        return false;
+    value = raw / scale;
+    return true;
+}
+
+bool read_chip (const cached_chip &c, chip &ch)
+{
+    ch.name = c.name;
+    ch.temps.resize (c.temps.size ());
+    for (size_t i = 0; i < c.temps.size (); ++i)
+    {
+        temperature &t = ch.temps[i];
+        t.current = t.high = t.critical = -1;
+        t.label = c.temps[i].label;
+        if (!read_attribute (c.temps[i].current, TEMPERATURE_SCALE, t.current)
+            || !read_attribute (c.temps[i].high, TEMPERATURE_SCALE, t.high)
+            || !read_attribute (c.temps[i].critical, TEMPERATURE_SCALE, t.critical))
+            return false;
+    }
+    ch.fan_speeds.resize (c.fan_speeds.size ());
+    for (size_t i = 0; i < c.fan_speeds.size (); ++i)
+    {
+        fan_speed &f = ch.fan_speeds[i];
+        f.current = -1;
+        f.label = c.fan_speeds[i].label;
+        if (!read_attribute (c.fan_speeds[i].current, FAN_SPEED_SCALE, f.current))
+            return false;
+    }
+    ch.measurements.resize (c.measurements.size ());
+    for (size_t i = 0; i < c.measurements.size (); ++i)
+    {
+        measurement &m = ch.measurements[i];
+        m.kind = c.measurements[i].kind;
+        m.current = -1;
+        m.label = c.measurements[i].label;
+        // like libsensors, a reading that can't be read right now is -1
+        read_attribute (c.measurements[i].current, c.measurements[i].scale, m.current);
+    }
+    return true;
+}
+
+/// @brief check if two readings of the same chip are identical
+///
+/// @param a first reading
+/// @param b second reading
+///
+/// @return true if they are
+static bool same_values (const chip &a, const chip &b)
+{
+    for (size_t i = 0; i < a.temps.size (); ++i)
+        if (a.temps[i].current != b.temps[i].current
+            || a.temps[i].high != b.temps[i].high
+            || a.temps[i].critical != b.temps[i].critical)
+            return false;
+    for (size_t i = 0; i < a.fan_speeds.size (); ++i)
+        if (a.fan_speeds[i].current != b.fan_speeds[i].current)
+            return false;
+    for (size_t i = 0; i < a.measurements.size (); ++i)
+        if (a.measurements[i].current != b.measurements[i].current)
+            return false;
+    return true;
+}
+
+bool resolve (const sensors &s, topology &t)
+{
+    t.boot_id = get_boot_id ();
+    t.configs = get_config_mtimes ();
+    t.hwmon = get_hwmon_devices ();
+    t.busses.clear ();
+    if (t.boot_id.empty ())
+        return false;
+    for (short i = 0; i < MAX_BUSSES; ++i)
+    {
+        auto chips = s.get_chips (i);
+        if (chips.empty ())
+            continue;
+        cached_bus b;
+        sensors_bus_id id { i, 0 };
+        const char *name = sensors_get_adapter_name (&id);
+        b.name = name == nullptr ? "Unknown" : name;
+        b.id = i;
+        for (auto c : chips)
+        {
+            if (c->path == nullptr)
+                return false;
+            cached_chip cc;
+            cc.name = c->prefix;
+            cc.path = c->path;
+            cc.mtime = get_mtime (cc.path);
+            chip_attributes a;
+            s.get_attributes (c, a);
+            cc.temps = a.temps;
+            cc.fan_speeds = a.fan_speeds;
+            cc.measurements = a.measurements;
+            // compare libsensors values with raw values read before and
+            // after, retrying if the sensor changed in between
+            bool same = false;
+            for (int tries = 0; !same && tries < 3; ++tries)
+            {
+                chip before, after;
+                if (!read_chip (cc, before))
+                    return false;
+                chip ch;
+                chip_features f;
+                s.get_features (c, f);
+                for (auto v : f.temps)
+                    ch.temps.push_back (temperature { v.current, v.high, v.critical, v.label });
+                for (auto v : f.fan_speeds)
+                    ch.fan_speeds.push_back (fan_speed { v.current, v.label });
+                for (auto v : f.measurements)
+                    ch.measurements.push_back (measurement { v.kind, v.current, v.label });
+                if (!read_chip (cc, after))
+                    return false;
+                if (!same_values (before, after))
+                    continue;
+                if (ch.temps.size () != before.temps.size ()
+                    || ch.fan_speeds.size () != before.fan_speeds.size ()
+                    || ch.measurements.size () != before.measurements.size ()
+                    || !same_values (before, ch))
+                    return false;
+                same = true;
+            }
+            if (!same)
+                return false;
+            b.chips.push_back (cc);
+        }
+        t.busses.push_back (b);
+    }
+    return true;
+}
+
+bool is_valid (const topology &t)
+{
+    if (t.boot_id != get_boot_id ())
+        return false;
+    if (t.configs != get_config_mtimes ())
+        return false;
+    if (t.hwmon != get_hwmon_devices ())
+        return false;
+    for (auto &b : t.busses)
+        for (auto &c : b.chips)
+            if (get_mtime (c.path) != c.mtime)
+                return false;
+    return true;
+}
+
+bool scan (const topology &t, busses &bs)
+{
+    bs.resize (t.busses.size ());
+    for (size_t i = 0; i < t.busses.size (); ++i)
+    {
+        bs[i].name = t.busses[i].name;
+        bs[i].id = t.busses[i].id;
+        bs[i].chips.resize (t.busses[i].chips.size ());
+        for (size_t j = 0; j < t.busses[i].chips.size (); ++j)
+            if (!read_chip (t.busses[i].chips[j], bs[i].chips[j]))
+                return false;
+    }
+    return true;
+}
+
+/// @brief write an attribute filename, '-' if empty
+///
+/// @param s stream
+/// @param fn the filename
+static void write_attribute (std::ostream &s, const std::string &fn)
+{
+    s << ' ' << (fn.empty () ? "-" : fn);
+}
+
+/// @brief read an attribute filename, '-' if empty
+///
+/// @param s stream
+/// @param fn the filename
+static void read_attribute (std::istream &s, std::string &fn)
+{
+    s >> fn;
+    if (fn == "-")
+        fn.clear ();
+}
+
+/// @brief write a label, which takes the rest of the line
+///
+/// @param s stream
+/// @param label the label
+static void write_label (std::ostream &s, const std::string &label)
+{
+    s << ' ' << label;
+}
+
+/// @brief read a label, which takes the rest of the line
+///
+/// @param s stream
+/// @param label the label
+static void read_label (std::istream &s, std::string &label)
+{
+    label.clear ();
+    s >> std::ws;
+    if (!s.eof ())
+        getline (s, label);
+    s.clear ();
+}
+
+std::ostream& operator<< (std::ostream &s, const topology &t)
+{
+    s << "version " << CACHE_VERSION << std::endl;
+    s << "boot_id " << t.boot_id << std::endl;
+    for (auto &c : t.configs)
+        s << "config " << c.second << ' ' << c.first << std::endl;
+    for (auto &h : t.hwmon)
+        s << "hwmon " << h << std::endl;
+    for (auto &b : t.busses)
+    {
+        s << "bus " << b.id << ' ' << b.name << std::endl;
+        for (auto &c : b.chips)
+        {
+            s << "chip " << c.mtime << ' ' << c.name << ' ' << c.path << std::endl;
+            for (auto &a : c.temps)
+            {
+                s << "temp";
+                write_attribute (s, a.current);
+                write_attribute (s, a.high);
+                write_attribute (s, a.critical);
+                write_label (s, a.label);
+                s << std::endl;
+            }
+            for (auto &a : c.fan_speeds)
+            {
+                s << "fan";
+                write_attribute (s, a.current);
+                write_label (s, a.label);
+                s << std::endl;
+            }
+            for (auto &a : c.measurements)
+            {
+                s << "measurement " << a.kind << ' ' << a.scale;
+                write_attribute (s, a.current);
+                write_label (s, a.label);
+                s << std::endl;
+            }
+        }
+    }
+    return s;
+}
+
+std::istream& operator>> (std::istream &s, topology &t)
+{
+    t = topology ();
+    std::string line;
+    int version = -1;
+    while (getline (s, line))
+    {
+        std::istringstream ss (line);
+        std::string key;
+        ss >> key;
+        if (key == "version")
+            ss >> version;
+        else if (key == "boot_id")
+            ss >> t.boot_id;
+        else if (key == "config")
+        {
+            std::pair<std::string, long long> c;
+            ss >> c.second >> c.first;
+            t.configs.push_back (c);
+        }
+        else if (key == "hwmon")
+        {
+            std::string h;
+            ss >> h;
+            t.hwmon.push_back (h);
+        }
+        else if (key == "bus")
+        {
+            cached_bus b;
+            ss >> b.id >> std::ws;
+            getline (ss, b.name);
+            t.busses.push_back (b);
+        }
+        else if (key == "chip" && !t.busses.empty ())
+        {
+            cached_chip c;
+            ss >> c.mtime >> c.name >> c.path;
+            t.busses.back ().chips.push_back (c);
+        }
+        else if (key == "temp" && !t.busses.empty () && !t.busses.back ().chips.empty ())
+        {
+            temperature_attributes a;
+            read_attribute (ss, a.current);
+            read_attribute (ss, a.high);
+            read_attribute (ss, a.critical);
+            if (ss)
+                read_label (ss, a.label);
+            t.busses.back ().chips.back ().temps.push_back (a);
+        }
+        else if (key == "fan" && !t.busses.empty () && !t.busses.back ().chips.empty ())
+        {
+            fan_speed_attributes a;
+            read_attribute (ss, a.current);
+            if (ss)
+                read_label (ss, a.label);
+            t.busses.back ().chips.back ().fan_speeds.push_back (a);
+        }
+        else if (key == "measurement" && !t.busses.empty () && !t.busses.back ().chips.empty ())
+        {
+            measurement_attributes a;
+            ss >> a.kind >> a.scale;
+            read_attribute (ss, a.current);
+            if (ss)
+                read_label (ss, a.label);
+            t.busses.back ().chips.back ().measurements.push_back (a);
+        }
+        else
+            throw std::runtime_error ("warning: unexpected line in topology cache");
+        if (!ss)
+            throw std::runtime_error ("warning: could not parse topology cache");
+    }
+    if (version != CACHE_VERSION)
+        throw std::runtime_error ("warning: topology cache has the wrong version");
+    return s;
+}
+
+void read (topology &t, const std::string &fn)
+{
+    std::clog << "reading topology cache " << fn << std::endl;
+    std::ifstream ifs (fn.c_str ());
+    if (!ifs)
+        throw std::runtime_error ("could not open topology cache for reading");
+    ifs >> t;
+}
+
+void write (const topology &t, const std::string &fn)
+{
+    std::clog << "writing topology cache " << fn << std::endl;
+    const std::string tmp = fn + "." + std::to_string (getpid ()) + ".tmp";
+    {
+        std::ofstream ofs (tmp.c_str ());
+        if (!ofs)
+            throw std::runtime_error ("could not open topology cache for writing");
+        ofs << t;
+        if (!ofs)
+            throw std::runtime_error ("could not write topology cache");
+    }
+    if (rename (tmp.c_str (), fn.c_str ()) == -1)
+        throw std::runtime_error ("could not rename topology cache");
+}
+
+bool load (topology &t, const std::string &fn)
+{
+    try
+    {
+        read (t, fn);
+        if (is_valid (t))
+            return true;
+        std::clog << "topology cache is out of date" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::clog << e.what () << std::endl;
+    }
+    t = topology ();
+    sensors s;
+    if (!resolve (s, t))
+        return false;
+    write (t, fn);
+    return true;
+}
+
+} // namespace therm
@@ -0,0 +1,181 @@
+/// @file cache.h
+/// @brief sensor topology cache
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "therm.h"
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief cache file format version
+const int CACHE_VERSION = 4;
+
+/// @brief sysfs units per degree
+const double TEMPERATURE_SCALE = 1000.0;
+
+/// @brief sysfs units per RPM
+const double FAN_SPEED_SCALE = 1.0;
+
+/// @brief a chip whose attributes are read directly from sysfs
+struct cached_chip
+{
+    std::string name;
+    /// @brief sysfs device directory
+    std::string path;
+    /// @brief modification time of the device directory
+    long long mtime;
+    std::vector<temperature_attributes> temps;
+    std::vector<fan_speed_attributes> fan_speeds;
+    std::vector<measurement_attributes> measurements;
+};
+
+/// @brief a bus whose chips are read directly from sysfs
+struct cached_bus
+{
+    std::string name;
+    unsigned id;
+    std::vector<cached_chip> chips;
+};
+
+/// @brief resolved chip/feature/subfeature mapping
+///
+/// The mapping is only valid for the boot it was resolved in, and only as
+/// long as the sensors configuration files and the hwmon devices are
+/// unchanged.
+struct topology
+{
+    std::string boot_id;
+    /// @brief sensors configuration files and their modification times
+    std::vector<std::pair<std::string, long long> > configs;
+    /// @brief the hwmon devices, so a device that appears later, like
+    /// one whose module is loaded after boot, is noticed
+    std::vector<std::string> hwmon;
+    std::vector<cached_bus> busses;
+};
+
+/// @brief get a file's modification time
+///
+/// @param fn filename
+///
+/// @return the time in ns, or -1 if the file does not exist
+long long get_mtime (const std::string &fn);
+
+/// @brief get the id of the current boot
+///
+/// @return the id
+std::string get_boot_id ();
+
+/// @brief get the sensors configuration files and their modification times
+///
+/// @return the files
+std::vector<std::pair<std::string, long long> > get_config_mtimes ();
+
+/// @brief get the hwmon devices
+///
+/// @param dir the hwmon class directory
+///
+/// @return their names, sorted
+std::vector<std::string> get_hwmon_devices (const std::string &dir = "/sys/class/hwmon");
+
+/// @brief read a sysfs attribute
+///
+/// @param fn attribute filename
+/// @param scale sysfs units per value unit
+/// @param value the value, unchanged if fn is empty
+///
+/// @return false if the attribute could not be read
+bool read_attribute (const std::string &fn, double scale, double &value);
+
+/// @brief read the values of a chip directly from sysfs
+///
+/// @param c the chip
+/// @param ch the values
+///
+/// @return false if a temperature or fan speed could not be read; a
+/// measurement that can't be read is -1
+bool read_chip (const cached_chip &c, chip &ch);
+
+/// @brief resolve the topology with libsensors
+///
+/// Values that libsensors transforms with 'compute' statements can't be read
+/// directly from sysfs, so the topology can't be cached when it has any.
+///
+/// @param s sensors
+/// @param t the topology
+///
+/// @return false if the topology can't be cached
+bool resolve (const sensors &s, topology &t);
+
+/// @brief check if a topology still describes the hardware
+///
+/// @param t the topology
+///
+/// @return true if it does
+bool is_valid (const topology &t);
+
+/// @brief scan the busses using a topology
+///
+/// @param t the topology
+/// @param bs vector of bus sensor data
+///
+/// @return false if an attribute could not be read
+bool scan (const topology &t, busses &bs);
+
+/// @brief i/o helper
+std::ostream& operator<< (std::ostream &s, const topology &t);
+
+/// @brief i/o helper
+std::istream& operator>> (std::istream &s, topology &t);
+
+/// @brief helper
+///
+/// @param t topology
+/// @param fn filename
+void read (topology &t, const std::string &fn);
+
+/// @brief helper
+///
+/// The cache is written to a temporary file first so that concurrent
+/// readers never see a partial file.
+///
+/// @param t topology
+/// @param fn filename
+void write (const topology &t, const std::string &fn);
+
+/// @brief get a valid topology
+///
+/// The cache is used if it is still valid.  Otherwise the topology is
+/// resolved with libsensors and the cache is rewritten.
+///
+/// @param t the topology
+/// @param fn cache filename
+///
+/// @return false if the topology can't be cached
+bool load (topology &t, const std::string &fn);
+
+} // namespace therm
+
+#endif
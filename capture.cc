@@ -0,0 +1,274 @@
+/// @file capture.cc
+/// @brief high rate sensor capture
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "capture.h"
+#include "shm.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <limits>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace therm
+{
+
+sample_ring::sample_ring (size_t capacity, size_t width)
+    : width (width)
+    , head (0)
+    , tail (0)
+{
+    size_t n = 1;
+    while (n < capacity)
+        n *= 2;
+    mask = n - 1;
+    data.resize (n * width);
+}
+
+capture::capture (const topology &t, const std::vector<uint32_t> &indices, unsigned rate)
+    : rate (rate)
+    // a second of samples
+    , ring (rate, indices.size () + 1)
+    , running (false)
+    , done (false)
+    , overruns (0)
+    , missed (0)
+    , start_time (0)
+{
+    if (rate == 0 || rate > CAPTURE_MAX_RATE)
+        throw std::runtime_error ("invalid capture rate");
+    // open each sensor's input attribute, in snapshot order
+    uint32_t n = 0;
+    size_t j = 0;
+    auto add = [&] (const std::string &fn, double scale)
+    {
+        if (j < indices.size () && indices[j] == n++)
+        {
+            ++j;
+            const int fd = open (fn.c_str (), O_RDONLY);
+            if (fd == -1)
+                throw std::runtime_error ("could not open " + fn);
+            channels.push_back (channel { fd, scale });
+        }
+    };
+    try
+    {
+        for (auto &b : t.busses)
+            for (auto &c : b.chips)
+            {
+                for (auto &a : c.temps)
+                    add (a.current, TEMPERATURE_SCALE);
+                for (auto &a : c.fan_speeds)
+                    add (a.current, FAN_SPEED_SCALE);
+                for (auto &a : c.measurements)
+                    add (a.current, a.scale);
+            }
+        // such as the RAPL readings, which aren't in the topology
+        if (j != indices.size ())
+            throw std::runtime_error ("some of the sensors can't be captured");
+    }
+    catch (...)
+    {
+        for (auto &c : channels)
+            close (c.fd);
+        throw;
+    }
+}
+
+capture::~capture ()
+{
+    stop ();
+    for (auto &c : channels)
+        close (c.fd);
+}
+
+void *capture::start_run (void *p)
+{
+    static_cast<capture *> (p)->run ();
+    return nullptr;
+}
+
+void capture::start (int cpu)
+{
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+        throw std::runtime_error ("invalid capture cpu " + std::to_string (cpu));
+    start_time = now_ms ();
+    // pin the thread before it runs, so no tick runs on another cpu
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    CPU_SET (cpu, &set);
+    pthread_attr_t attr;
+    pthread_attr_init (&attr);
+    int err = pthread_attr_setaffinity_np (&attr, sizeof (set), &set);
+    if (!err)
+        err = pthread_create (&thread, &attr, &capture::start_run, this);
+    pthread_attr_destroy (&attr);
+    if (err)
+        throw std::runtime_error ("could not start the capture thread on cpu " + std::to_string (cpu) + ": " + strerror (err));
+    running = true;
+}
+
+void capture::stop ()
+{
+    done = true;
+    if (running)
+        pthread_join (thread, nullptr);
+    running = false;
+}
+
+/// @brief get the time difference in ns
+///
+/// @param a later time
+/// @param b earlier time
+///
+/// @return the difference
+static int64_t diff_ns (const timespec &a, const timespec &b)
+{
+    return (a.tv_sec - b.tv_sec) * 1000000000LL + (a.tv_nsec - b.tv_nsec);
+}
+
+/// @brief add ns to a time
+///
+/// @param t the time
+/// @param ns ns to add
+static void add_ns (timespec &t, long ns)
+{
+    t.tv_nsec += ns;
+    while (t.tv_nsec >= 1000000000L)
+    {
+        t.tv_nsec -= 1000000000L;
+        ++t.tv_sec;
+    }
+}
+
+void capture::run ()
+{
+    const long period = 1000000000L / rate;
+    const double nan = std::numeric_limits<double>::quiet_NaN ();
+    timespec start, next, now;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    next = start;
+    while (!done.load (std::memory_order_relaxed))
+    {
+        add_ns (next, period);
+        while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &next, 0) == EINTR)
+            ;
+        clock_gettime (CLOCK_MONOTONIC, &now);
+        double *s = ring.write_slot ();
+        if (s == 0)
+        {
+            overruns.fetch_add (1, std::memory_order_relaxed);
+            continue;
+        }
+        s[0] = diff_ns (now, start);
+        for (size_t i = 0; i < channels.size (); ++i)
+        {
+            // sysfs regenerates the attribute on each read at offset 0
+            char buf[32];
+            const ssize_t n = pread (channels[i].fd, buf, sizeof (buf) - 1, 0);
+            double v = nan;
+            if (n > 0)
+            {
+                buf[n] = 0;
+                char *end;
+                const long long raw = strtoll (buf, &end, 10);
+                if (end != buf)
+                    v = raw / channels[i].scale;
+            }
+            s[i + 1] = v;
+        }
+        ring.push ();
+        // don't try to catch up on ticks that were missed
+        clock_gettime (CLOCK_MONOTONIC, &now);
+        if (diff_ns (now, next) > period)
+        {
+            missed.fetch_add (diff_ns (now, next) / period, std::memory_order_relaxed);
+            next = now;
+        }
+    }
+}
+
+capture_window::capture_window (size_t width, size_t before, size_t after)
+    : data ((before + after + 1) * width)
+    , width (width)
+    , capacity (before + after + 1)
+    , after (after)
+    , size (0)
+    , head (0)
+    , remaining (0)
+    , triggered (false)
+    , trigger_time (0)
+{
+}
+
+bool capture_window::add (const double *s, bool trigger)
+{
+    std::copy (s, s + width, &data[head * width]);
+    head = (head + 1) % capacity;
+    size = std::min (size + 1, capacity);
+    if (!triggered)
+    {
+        if (!trigger)
+            return false;
+        triggered = true;
+        trigger_time = s[0];
+        remaining = after;
+    }
+    else
+        --remaining;
+    if (remaining != 0)
+        return false;
+    triggered = false;
+    return true;
+}
+
+void capture_window::write (const std::string &fn, const std::vector<std::string> &names) const
+{
+    const std::string tmp = fn + "." + std::to_string (getpid ()) + ".tmp";
+    {
+        std::ofstream ofs (tmp.c_str ());
+        if (!ofs)
+            throw std::runtime_error ("could not open " + tmp + " for writing");
+        ofs << "time";
+        for (auto &n : names)
+            ofs << ',' << n;
+        ofs << std::endl;
+        ofs.precision (10);
+        for (size_t i = 0; i < size; ++i)
+        {
+            const double *s = &data[((head + capacity - size + i) % capacity) * width];
+            ofs << (s[0] - trigger_time) / 1e6;
+            for (size_t j = 1; j < width; ++j)
+                ofs << ',' << s[j];
+            ofs << '\n';
+        }
+        if (!ofs)
+            throw std::runtime_error ("could not write " + tmp);
+    }
+    if (rename (tmp.c_str (), fn.c_str ()) == -1)
+        throw std::runtime_error ("could not rename " + tmp + " to " + fn);
+}
+
+} // namespace therm
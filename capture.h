@@ -0,0 +1,203 @@
+/// @file capture.h
+/// @brief high rate sensor capture
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "cache.h"
+#include <atomic>
+#include <cstdint>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief highest capture rate in Hz
+const unsigned CAPTURE_MAX_RATE = 10000;
+
+/// @brief lock free single producer, single consumer ring of samples
+///
+/// Each slot holds a fixed number of doubles.  All storage is allocated up
+/// front, so neither side allocates.
+class sample_ring
+{
+    public:
+    /// @brief constructor
+    ///
+    /// @param capacity minimum number of slots
+    /// @param width doubles per slot
+    sample_ring (size_t capacity, size_t width);
+    /// @brief get the number of doubles per slot
+    ///
+    /// @return the width
+    size_t get_width () const { return width; }
+    /// @brief get the next slot to write, called by the producer
+    ///
+    /// @return the slot, or 0 if the ring is full
+    double *write_slot ()
+    {
+        const size_t h = head.load (std::memory_order_relaxed);
+        if (h - tail.load (std::memory_order_acquire) > mask)
+            return 0;
+        return &data[(h & mask) * width];
+    }
+    /// @brief publish the slot returned by write_slot
+    void push ()
+    {
+        head.store (head.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    /// @brief get the oldest slot, called by the consumer
+    ///
+    /// @return the slot, or 0 if the ring is empty
+    const double *read_slot () const
+    {
+        const size_t t = tail.load (std::memory_order_relaxed);
+        if (t == head.load (std::memory_order_acquire))
+            return 0;
+        return &data[(t & mask) * width];
+    }
+    /// @brief release the slot returned by read_slot
+    void pop ()
+    {
+        tail.store (tail.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    private:
+    std::vector<double> data;
+    size_t width;
+    size_t mask;
+    /// @brief the producer and consumer counters are on their own cache
+    /// lines so that they don't bounce between cores
+    alignas (64) std::atomic<size_t> head;
+    alignas (64) std::atomic<size_t> tail;
+};
+
+/// @brief sample some sensors at a high rate
+///
+/// A thread pinned to one cpu reads the sensors' sysfs attributes through
+/// file descriptors that are opened once, and pushes a sample into a ring on
+/// each tick.  Each sample holds the time in ns since the capture started,
+/// followed by the value of each sensor.  The thread does not allocate.
+class capture
+{
+    public:
+    /// @brief constructor
+    ///
+    /// @param t the topology
+    /// @param indices sorted indices of the sensors to sample, in snapshot
+    /// order
+    /// @param rate samples per second
+    capture (const topology &t, const std::vector<uint32_t> &indices, unsigned rate);
+    /// @brief destructor
+    ~capture ();
+    capture (const capture &) = delete;
+    capture &operator= (const capture &) = delete;
+    /// @brief start sampling
+    ///
+    /// @param cpu the cpu to run on
+    void start (int cpu);
+    /// @brief stop sampling
+    void stop ();
+    /// @brief get the samples
+    ///
+    /// @return the ring
+    sample_ring &get_ring () { return ring; }
+    /// @brief get the time the capture started
+    ///
+    /// @return ms since the epoch
+    uint64_t get_start_time () const { return start_time; }
+    /// @brief get the number of samples dropped because the ring was full
+    ///
+    /// @return the count
+    uint64_t get_overruns () const { return overruns.load (); }
+    /// @brief get the number of ticks missed because sampling took too long
+    ///
+    /// @return the count
+    uint64_t get_missed () const { return missed.load (); }
+    private:
+    /// @brief the sampling loop
+    void run ();
+    /// @brief pthread entry point
+    ///
+    /// @param p the capture
+    ///
+    /// @return nullptr
+    static void *start_run (void *p);
+    struct channel
+    {
+        int fd;
+        double scale;
+    };
+    std::vector<channel> channels;
+    unsigned rate;
+    sample_ring ring;
+    pthread_t thread;
+    bool running;
+    std::atomic<bool> done;
+    std::atomic<uint64_t> overruns;
+    std::atomic<uint64_t> missed;
+    uint64_t start_time;
+};
+
+/// @brief keep the samples around a trigger
+///
+/// Samples go into a circular buffer that holds the window before the
+/// trigger, the trigger and the window after it.
+class capture_window
+{
+    public:
+    /// @brief constructor
+    ///
+    /// @param width doubles per sample, the time first
+    /// @param before samples to keep before the trigger
+    /// @param after samples to keep after the trigger
+    capture_window (size_t width, size_t before, size_t after);
+    /// @brief add a sample
+    ///
+    /// Triggers are ignored until the window of the previous one is complete.
+    ///
+    /// @param s the sample
+    /// @param trigger true if the sample triggered
+    ///
+    /// @return true if the window after a trigger is complete
+    bool add (const double *s, bool trigger);
+    /// @brief write the last window as comma separated values
+    ///
+    /// Times are in ms relative to the trigger.
+    ///
+    /// @param fn filename
+    /// @param names sensor names
+    void write (const std::string &fn, const std::vector<std::string> &names) const;
+    private:
+    std::vector<double> data;
+    size_t width;
+    size_t capacity;
+    size_t after;
+    size_t size;
+    size_t head;
+    size_t remaining;
+    bool triggered;
+    double trigger_time;
+};
+
+} // namespace therm
+
+#endif
@@ -0,0 +1,191 @@
+/// @file cpufreq.cc
+/// @brief processor frequencies and thermal throttling
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "cpufreq.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+namespace therm
+{
+
+/// @brief read a number from a sysfs attribute
+///
+/// @param fd attribute file
+/// @param x the number
+///
+/// @return false if it could not be read
+static bool read_number (int fd, uint64_t &x)
+{
+    if (fd == -1)
+        return false;
+    char buf[32];
+    const ssize_t n = pread (fd, buf, sizeof (buf) - 1, 0);
+    if (n <= 0)
+        return false;
+    buf[n] = 0;
+    char *end;
+    x = strtoull (buf, &end, 10);
+    return end != buf;
+}
+
+/// @brief get the package id of a package temperature label
+///
+/// @param label the label
+///
+/// @return the id, or -1 if it isn't a package temperature
+static int get_package (const std::string &label)
+{
+    int id;
+    if (sscanf (label.c_str (), "Package id %d", &id) == 1
+        || sscanf (label.c_str (), "Physical id %d", &id) == 1)
+        return id;
+    return -1;
+}
+
+int get_package (const chip &c)
+{
+    for (auto &t : c.temps)
+        if (get_package (t.label) != -1)
+            return get_package (t.label);
+    return -1;
+}
+
+cpufreq::cpufreq (const std::string &dir)
+{
+    std::vector<int> ids;
+    DIR *d = opendir (dir.c_str ());
+    if (d == nullptr)
+        return;
+    while (dirent *e = readdir (d))
+    {
+        const std::string name (e->d_name);
+        if (name.size () > 3 && name.compare (0, 3, "cpu") == 0 && isdigit (name[3]))
+            ids.push_back (atoi (name.c_str () + 3));
+    }
+    closedir (d);
+    std::sort (ids.begin (), ids.end ());
+    for (auto id : ids)
+    {
+        const std::string cpu_dir = dir + "/cpu" + std::to_string (id);
+        cpu c;
+        std::ifstream package ((cpu_dir + "/topology/physical_package_id").c_str ());
+        std::ifstream core ((cpu_dir + "/topology/core_id").c_str ());
+        // offline cpus have no topology
+        if (!(package >> c.package) || !(core >> c.core))
+            continue;
+        c.freq_fd = open ((cpu_dir + "/cpufreq/scaling_cur_freq").c_str (), O_RDONLY | O_CLOEXEC);
+        c.core_fd = open ((cpu_dir + "/thermal_throttle/core_throttle_count").c_str (), O_RDONLY | O_CLOEXEC);
+        c.package_fd = open ((cpu_dir + "/thermal_throttle/package_throttle_count").c_str (), O_RDONLY | O_CLOEXEC);
+        if (c.freq_fd == -1 && c.core_fd == -1 && c.package_fd == -1)
+            continue;
+        // the first events are counted from here
+        c.core_count = c.package_count = 0;
+        read_number (c.core_fd, c.core_count);
+        read_number (c.package_fd, c.package_count);
+        c.freq = c.core_events = c.package_events = -1;
+        cpus.push_back (c);
+    }
+}
+
+cpufreq::~cpufreq ()
+{
+    for (auto &c : cpus)
+        for (int fd : { c.freq_fd, c.core_fd, c.package_fd })
+            if (fd != -1)
+                close (fd);
+}
+
+double cpufreq::read_events (int fd, uint64_t &count)
+{
+    uint64_t x;
+    if (!read_number (fd, x))
+        return -1;
+    // the counters only go down if the cpu went offline and back
+    const double events = x >= count ? x - count : 0;
+    count = x;
+    return events;
+}
+
+void cpufreq::scan (busses &bs)
+{
+    if (cpus.empty ())
+        return;
+    for (auto &c : cpus)
+    {
+        uint64_t khz;
+        c.freq = read_number (c.freq_fd, khz) ? khz / 1e6 : -1;
+        c.core_events = read_events (c.core_fd, c.core_count);
+        c.package_events = read_events (c.package_fd, c.package_count);
+    }
+    for (auto &b : bs)
+    {
+        int n = 0;
+        for (auto &c : b.chips)
+            if (c.name == CORETEMP_CHIP)
+            {
+                // chips without a package temperature are in package order
+                const int package = get_package (c);
+                add (c, package == -1 ? n : package);
+                ++n;
+            }
+    }
+}
+
+void cpufreq::add (chip &ch, int package) const
+{
+    for (auto &t : ch.temps)
+    {
+        const std::string &label = t.label;
+        int core;
+        if (sscanf (label.c_str (), "Core %d", &core) == 1)
+        {
+            double freq = -1;
+            double events = -1;
+            for (auto &c : cpus)
+                if (c.package == package && c.core == core)
+                {
+                    freq = std::max (freq, c.freq);
+                    events = std::max (events, c.core_events);
+                }
+            if (freq >= 0)
+                ch.measurements.push_back (measurement { FREQUENCY, freq, label });
+            if (events >= 0)
+                ch.measurements.push_back (measurement { THROTTLE, events, label });
+        }
+        else if (get_package (label) == package)
+        {
+            double events = -1;
+            for (auto &c : cpus)
+                if (c.package == package)
+                    events = std::max (events, c.package_events);
+            if (events >= 0)
+                ch.measurements.push_back (measurement { THROTTLE, events, label });
+        }
+    }
+}
+
+} // namespace therm
@@ -0,0 +1,105 @@
+/// @file cpufreq.h
+/// @brief processor frequencies and thermal throttling
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef CPUFREQ_H
+#define CPUFREQ_H
+
+#include "therm.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief default cpu sysfs directory
+const char *const CPU_DIR = "/sys/devices/system/cpu";
+
+/// @brief name of the chips whose rows get the frequencies
+const char *const CORETEMP_CHIP = "coretemp";
+
+/// @brief get the package id of a coretemp chip
+///
+/// @param c the chip
+///
+/// @return the id, or -1 if it has no package temperature
+int get_package (const chip &c);
+
+/// @brief read the processor frequencies and thermal throttle counters
+///
+/// The current frequency of each core and the number of times it was
+/// throttled since the previous scan are added to the coretemp chips, next
+/// to the core's temperature and with the same label, and the number of
+/// times the package was throttled goes with the package temperature.  A
+/// core's frequency is the highest of its hardware threads'.
+class cpufreq
+{
+    public:
+    /// @brief constructor
+    ///
+    /// @param dir cpu sysfs directory
+    cpufreq (const std::string &dir = CPU_DIR);
+    /// @brief destructor
+    ~cpufreq ();
+    cpufreq (const cpufreq &) = delete;
+    cpufreq &operator= (const cpufreq &) = delete;
+    /// @brief check if there are any readable cpus
+    ///
+    /// @return true if there are
+    bool empty () const { return cpus.empty (); }
+    /// @brief add the frequencies and throttle events to a snapshot
+    ///
+    /// @param bs vector of bus sensor data
+    void scan (busses &bs);
+    private:
+    struct cpu
+    {
+        int package;
+        int core;
+        int freq_fd;
+        int core_fd;
+        int package_fd;
+        /// @brief the previous counter readings
+        uint64_t core_count;
+        uint64_t package_count;
+        /// @brief the latest readings, in GHz and events since the previous scan
+        double freq;
+        double core_events;
+        double package_events;
+    };
+    /// @brief read a throttle counter
+    ///
+    /// @param fd counter file
+    /// @param count the previous reading, updated
+    ///
+    /// @return the number of events since the previous reading, or -1
+    static double read_events (int fd, uint64_t &count);
+    /// @brief add the readings to a coretemp chip
+    ///
+    /// @param c the chip
+    /// @param package its package id
+    void add (chip &c, int package) const;
+    std::vector<cpu> cpus;
+};
+
+} // namespace therm
+
+#endif
@@ -0,0 +1,247 @@
+/// @file events.cc
+/// @brief threshold crossing events
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "events.h"
+#include "shm.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace therm
+{
+
+/// @brief sensor states
+enum sensor_state
+{
+    STATE_NORMAL,
+    STATE_HIGH,
+    STATE_CRITICAL,
+    STATE_STALLED,
+    STATE_LOST
+};
+
+const char *get_name (event_type type)
+{
+    switch (type)
+    {
+        case ENTERED_HIGH: return "entered_high";
+        case ENTERED_CRITICAL: return "entered_critical";
+        case RECOVERED: return "recovered";
+        case SENSOR_LOST: return "sensor_lost";
+        case FAN_STALLED: return "fan_stalled";
+    }
+    return "unknown";
+}
+
+std::ostream& operator<< (std::ostream &s, const event &e)
+{
+    s << e.time
+        << ' ' << get_name (event_type (e.type))
+        << " [" << e.id.bus_id << "] " << e.chip_name << ' ' << e.id.chip
+        << (e.id.type == FAN_SENSOR ? " fan " : " temp ") << e.id.index
+        << ' ' << e.value;
+    return s;
+}
+
+/// @brief get the state of a temperature
+///
+/// @param t temperature
+/// @param prev previous state
+/// @param hysteresis hysteresis in degrees
+///
+/// @return the state
+static uint8_t get_state (const temperature &t, uint8_t prev, double hysteresis)
+{
+    // a temperature that can't be read is -1, like a fan speed
+    if (!std::isfinite (t.current) || t.current < 0)
+        return STATE_LOST;
+    const double crit_hyst = prev == STATE_CRITICAL ? hysteresis : 0.0;
+    if (t.critical > 0 && t.current > t.critical - crit_hyst)
+        return STATE_CRITICAL;
+    const double high_hyst = (prev == STATE_HIGH || prev == STATE_CRITICAL) ? hysteresis : 0.0;
+    if (t.high > 0 && t.current > t.high - high_hyst)
+        return STATE_HIGH;
+    return STATE_NORMAL;
+}
+
+/// @brief get the state of a fan
+///
+/// @param f fan speed
+///
+/// @return the state
+static uint8_t get_state (const fan_speed &f)
+{
+    if (!std::isfinite (f.current) || f.current < 0)
+        return STATE_LOST;
+    if (f.current == 0)
+        return STATE_STALLED;
+    return STATE_NORMAL;
+}
+
+event_engine::event_engine ()
+    : next_id (0)
+    , dropped (0)
+    , hysteresis (0)
+    , now (0)
+{
+    fds[0] = fds[1] = -1;
+}
+
+event_engine::~event_engine ()
+{
+    if (fds[0] != -1)
+        close (fds[0]);
+    if (fds[1] != -1)
+        close (fds[1]);
+}
+
+void event_engine::set_hysteresis (double degrees)
+{
+    hysteresis = degrees;
+}
+
+unsigned event_engine::subscribe (const callback &f)
+{
+    subscription sub { next_id++, f };
+    subscriptions.push_back (sub);
+    return sub.id;
+}
+
+void event_engine::unsubscribe (unsigned id)
+{
+    for (size_t i = 0; i < subscriptions.size (); ++i)
+    {
+        if (subscriptions[i].id != id)
+            continue;
+        subscriptions.erase (subscriptions.begin () + i);
+        return;
+    }
+}
+
+int event_engine::get_fd ()
+{
+    if (fds[0] == -1 && pipe2 (fds, O_NONBLOCK | O_CLOEXEC) == -1)
+        throw std::runtime_error ("could not create event pipe");
+    return fds[0];
+}
+
+size_t event_engine::get_dropped () const
+{
+    return dropped;
+}
+
+bool event_engine::is_active () const
+{
+    return !subscriptions.empty () || fds[0] != -1;
+}
+
+void event_engine::emit (event_type type, const sensor_id &id, double value, const std::string &chip_name)
+{
+    event e;
+    memset (&e, 0, sizeof (e));
+    e.time = now;
+    e.type = type;
+    e.id = id;
+    e.value = value;
+    strncpy (e.chip_name, chip_name.c_str (), EVENT_NAME_SIZE - 1);
+    // callbacks may unsubscribe, so iterate over a copy
+    auto subs = subscriptions;
+    for (auto &s : subs)
+        s.f (e);
+    if (fds[1] != -1 && ::write (fds[1], &e, sizeof (e)) != sizeof (e))
+        ++dropped;
+}
+
+void event_engine::update (const busses &bs)
+{
+    now = now_ms ();
+    new_ids.clear ();
+    new_states.clear ();
+    new_values.clear ();
+    size_t n = 0;
+    // state transitions
+    for (auto &b : bs)
+    {
+        for (size_t j = 0; j < b.chips.size (); ++j)
+        {
+            const chip &c = b.chips[j];
+            for (size_t k = 0; k < c.temps.size () + c.fan_speeds.size (); ++k, ++n)
+            {
+                const bool fan = k >= c.temps.size ();
+                const sensor_id id { b.id, uint32_t (j), uint32_t (fan ? FAN_SENSOR : TEMPERATURE_SENSOR), uint32_t (fan ? k - c.temps.size () : k) };
+                // ids are sorted, so the old state is usually at the same
+                // position, and can be searched for otherwise
+                uint8_t prev = STATE_NORMAL;
+                if (n < ids.size () && ids[n] == id)
+                    prev = states[n];
+                else
+                {
+                    auto i = std::lower_bound (ids.begin (), ids.end (), id);
+                    if (i != ids.end () && *i == id)
+                        prev = states[i - ids.begin ()];
+                }
+                const double value = fan ? c.fan_speeds[k - c.temps.size ()].current : c.temps[k].current;
+                const uint8_t state = fan
+                    ? get_state (c.fan_speeds[k - c.temps.size ()])
+                    : get_state (c.temps[k], prev, hysteresis);
+                new_ids.push_back (id);
+                new_states.push_back (state);
+                new_values.push_back (value);
+                if (state == prev)
+                    continue;
+                switch (state)
+                {
+                    case STATE_NORMAL: emit (RECOVERED, id, value, c.name); break;
+                    case STATE_HIGH: emit (ENTERED_HIGH, id, value, c.name); break;
+                    case STATE_CRITICAL: emit (ENTERED_CRITICAL, id, value, c.name); break;
+                    case STATE_STALLED: emit (FAN_STALLED, id, value, c.name); break;
+                    case STATE_LOST: emit (SENSOR_LOST, id, value, c.name); break;
+                }
+            }
+        }
+    }
+    // sensors that disappeared
+    if (new_ids != ids)
+    {
+        for (size_t i = 0; i < ids.size (); ++i)
+        {
+            if (states[i] == STATE_LOST || std::binary_search (new_ids.begin (), new_ids.end (), ids[i]))
+                continue;
+            emit (SENSOR_LOST, ids[i], values[i], names[i]);
+        }
+        names.clear ();
+        for (auto &b : bs)
+            for (auto &c : b.chips)
+                names.insert (names.end (), c.temps.size () + c.fan_speeds.size (), c.name);
+    }
+    ids.swap (new_ids);
+    states.swap (new_states);
+    values.swap (new_values);
+}
+
+bool read_event (int fd, event &e)
+{
+    return ::read (fd, &e, sizeof (e)) == sizeof (e);
+}
+
+} // namespace therm
@@ -0,0 +1,196 @@
+/// @file events.h
+/// @brief threshold crossing events
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "therm.h"
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief kinds of events
+enum event_type
+{
+    ENTERED_HIGH,
+    ENTERED_CRITICAL,
+    RECOVERED,
+    SENSOR_LOST,
+    FAN_STALLED
+};
+
+/// @brief kinds of sensors
+enum sensor_type
+{
+    TEMPERATURE_SENSOR,
+    FAN_SENSOR
+};
+
+/// @brief identifies a sensor within a snapshot
+struct sensor_id
+{
+    uint32_t bus_id;
+    /// @brief index of the chip on its bus
+    uint32_t chip;
+    uint32_t type;
+    /// @brief index of the sensor on its chip
+    uint32_t index;
+};
+
+inline bool operator== (const sensor_id &a, const sensor_id &b)
+{
+    return a.bus_id == b.bus_id && a.chip == b.chip && a.type == b.type && a.index == b.index;
+}
+
+inline bool operator< (const sensor_id &a, const sensor_id &b)
+{
+    if (a.bus_id != b.bus_id)
+        return a.bus_id < b.bus_id;
+    if (a.chip != b.chip)
+        return a.chip < b.chip;
+    if (a.type != b.type)
+        return a.type < b.type;
+    return a.index < b.index;
+}
+
+/// @brief size of the chip name in an event
+const size_t EVENT_NAME_SIZE = 32;
+
+/// @brief a sensor changed state
+///
+/// Events have a fixed size so that they can be written to a pipe
+/// atomically.
+struct event
+{
+    /// @brief time in ms since the epoch
+    uint64_t time;
+    uint32_t type;
+    sensor_id id;
+    /// @brief the value that caused the event, or the last known value for SENSOR_LOST
+    double value;
+    char chip_name[EVENT_NAME_SIZE];
+};
+
+/// @brief get the name of an event type
+///
+/// @param type the event type
+///
+/// @return the name
+const char *get_name (event_type type);
+
+/// @brief i/o helper
+std::ostream& operator<< (std::ostream &s, const event &e);
+
+/// @brief detect threshold crossings between snapshots
+///
+/// Only state changes produce events.  When the topology is the same as in
+/// the previous snapshot, which is almost always the case, each sensor costs
+/// one comparison of its new state with its old state.
+class event_engine
+{
+    public:
+    /// @brief event callback
+    typedef std::function<void (const event &e)> callback;
+    /// @brief constructor
+    event_engine ();
+    /// @brief destructor
+    ~event_engine ();
+    event_engine (const event_engine &) = delete;
+    event_engine &operator= (const event_engine &) = delete;
+    /// @brief set the hysteresis
+    ///
+    /// A temperature has to drop this many degrees below a threshold before
+    /// it leaves that state.
+    ///
+    /// @param degrees the hysteresis
+    void set_hysteresis (double degrees);
+    /// @brief subscribe to events
+    ///
+    /// @param f callback
+    ///
+    /// @return subscription id
+    unsigned subscribe (const callback &f);
+    /// @brief remove a subscription
+    ///
+    /// @param id subscription id
+    void unsubscribe (unsigned id);
+    /// @brief get a file descriptor that events can be read from
+    ///
+    /// The descriptor is the read end of a non-blocking pipe, suitable for
+    /// select, poll or epoll.  Read events from it with read_event ().  If
+    /// the reader falls behind and the pipe fills up, events are dropped
+    /// rather than blocking the sampler.
+    ///
+    /// @return the descriptor
+    int get_fd ();
+    /// @brief get the number of events dropped because the pipe was full
+    ///
+    /// @return the number of events
+    size_t get_dropped () const;
+    /// @brief check if anyone is listening for events
+    ///
+    /// @return true if there are subscribers or a file descriptor
+    bool is_active () const;
+    /// @brief detect events in a new snapshot
+    ///
+    /// @param bs vector of bus sensor data
+    void update (const busses &bs);
+    private:
+    /// @brief emit an event
+    ///
+    /// @param type event type
+    /// @param id sensor
+    /// @param value sensor value
+    /// @param chip_name chip name
+    void emit (event_type type, const sensor_id &id, double value, const std::string &chip_name);
+    struct subscription
+    {
+        unsigned id;
+        callback f;
+    };
+    std::vector<subscription> subscriptions;
+    unsigned next_id;
+    int fds[2];
+    size_t dropped;
+    double hysteresis;
+    /// @brief sensor ids and states in snapshot order
+    std::vector<sensor_id> ids, new_ids;
+    std::vector<uint8_t> states, new_states;
+    std::vector<double> values, new_values;
+    std::vector<std::string> names;
+    uint64_t now;
+};
+
+/// @brief read an event from an event file descriptor
+///
+/// @param fd the descriptor
+/// @param e the event
+///
+/// @return false if there are no events to read
+bool read_event (int fd, event &e);
+
+} // namespace therm
+
+#endif
@@ -0,0 +1,217 @@
+/// @file fans.cc
+/// @brief learned fan speed envelopes
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "fans.h"
+#include "alerts.h"
+#include <algorithm>
+#include <cmath>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace therm
+{
+
+/// @brief the start of the model file
+struct fan_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t envelopes;
+    uint32_t reserved;
+};
+
+const char *get_name (fan_health h)
+{
+    switch (h)
+    {
+        default:
+        case HEALTH_LEARNING: return "learning";
+        case HEALTH_OK: return "ok";
+        case HEALTH_STALLED: return "stalled";
+        case HEALTH_DEGRADED: return "degraded";
+        case HEALTH_PINNED: return "pinned";
+    }
+}
+
+fan_model::fan_model (const std::string &fn)
+    : fn (fn)
+    , changed (false)
+{
+    const int fd = fn.empty () ? -1 : open (fn.c_str (), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return;
+    struct stat st;
+    void *p = MAP_FAILED;
+    if (fstat (fd, &st) == 0 && size_t (st.st_size) >= sizeof (fan_header))
+        p = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (p == MAP_FAILED)
+        return;
+    const fan_header *h = static_cast<const fan_header *> (p);
+    const fan_envelope *e = reinterpret_cast<const fan_envelope *> (h + 1);
+    // ignore a model of another version, or one that was cut short
+    if (h->magic == FAN_MAGIC && h->version == FAN_VERSION
+        && sizeof (fan_header) + h->envelopes * sizeof (fan_envelope) == size_t (st.st_size))
+        envelopes.assign (e, e + h->envelopes);
+    munmap (p, st.st_size);
+    std::sort (envelopes.begin (), envelopes.end (), [] (const fan_envelope &a, const fan_envelope &b)
+    {
+        return a.key < b.key;
+    });
+}
+
+size_t fan_model::find (uint64_t key)
+{
+    auto i = std::lower_bound (envelopes.begin (), envelopes.end (), key, [] (const fan_envelope &e, uint64_t key)
+    {
+        return e.key < key;
+    });
+    if (i == envelopes.end () || i->key != key)
+        i = envelopes.insert (i, fan_envelope { key, 0, 0, 0, 0, 0, 0, 0, 0, 0 });
+    return i - envelopes.begin ();
+}
+
+void fan_model::update (const busses &bs)
+{
+    // look the fans up when the topology changes
+    size_t n = 0;
+    bool same = true;
+    for (auto &b : bs)
+        for (size_t j = 0; j < b.chips.size (); ++j)
+            for (auto &f : b.chips[j].fan_speeds)
+                same = same && n < names.size () && names[n++] == f.label;
+    if (!same || n != names.size ())
+    {
+        names.clear ();
+        std::vector<uint64_t> keys;
+        for (auto &b : bs)
+            for (size_t j = 0; j < b.chips.size (); ++j)
+                for (auto &f : b.chips[j].fan_speeds)
+                {
+                    names.push_back (f.label);
+                    keys.push_back (get_alert_key (std::to_string (b.id) + '/' + std::to_string (j) + '/' + b.chips[j].name + '/' + f.label));
+                }
+        // adding envelopes moves the others, so add them all first
+        for (auto k : keys)
+            find (k);
+        indices.clear ();
+        for (auto k : keys)
+            indices.push_back (find (k));
+    }
+    health.assign (names.size (), HEALTH_LEARNING);
+    expected.assign (names.size (), 0);
+    max.assign (names.size (), 0);
+    // the hottest temperature of all, for chips that have fans but no
+    // temperatures
+    double hottest = -1;
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+            for (auto &t : c.temps)
+                if (std::isfinite (t.current))
+                    hottest = std::max (hottest, t.current);
+    n = 0;
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+        {
+            double x = -1;
+            for (auto &t : c.temps)
+                if (std::isfinite (t.current))
+                    x = std::max (x, t.current);
+            if (x == -1)
+                x = hottest;
+            for (auto &f : c.fan_speeds)
+            {
+                fan_envelope &e = envelopes[indices[n]];
+                const size_t i = n++;
+                const double r = f.current;
+                if (!std::isfinite (r) || r < 0 || x == -1)
+                    continue;
+                max[i] = e.max;
+                uint8_t h = HEALTH_LEARNING;
+                if (e.n >= FAN_MIN_SAMPLES)
+                {
+                    // expected speed at this temperature, or the average if
+                    // the temperature hasn't varied enough to tell
+                    const double var = e.n * e.sxx - e.sx * e.sx;
+                    double y = e.sy / e.n;
+                    if (var > e.n * e.n)
+                        y += (e.n * e.sxy - e.sx * e.sy) / var * (x - e.sx / e.n);
+                    y = std::min<double> (std::max<double> (y, e.stops ? 0 : e.min), e.max);
+                    expected[i] = y;
+                    // a fan that stops by itself can't be told from a
+                    // stalled one
+                    if (r == 0)
+                        h = e.stops ? HEALTH_OK : HEALTH_STALLED;
+                    else if (r < FAN_DEGRADED * y)
+                        h = HEALTH_DEGRADED;
+                    else if (r >= FAN_PINNED * e.max && y < FAN_PINNED_EXPECTED * e.max)
+                        h = HEALTH_PINNED;
+                    else
+                        h = HEALTH_OK;
+                }
+                health[i] = h;
+                if (h != HEALTH_LEARNING && h != HEALTH_OK)
+                    continue;
+                // learn the healthy samples
+                if (r == 0)
+                    e.stops = e.stops || h == HEALTH_LEARNING;
+                else
+                {
+                    e.min = e.min == 0 ? r : std::min<float> (e.min, r);
+                    e.max = std::max<float> (e.max, r);
+                }
+                e.n = e.n * FAN_DECAY + 1;
+                e.sx = e.sx * FAN_DECAY + x;
+                e.sy = e.sy * FAN_DECAY + r;
+                e.sxx = e.sxx * FAN_DECAY + x * x;
+                e.sxy = e.sxy * FAN_DECAY + x * r;
+                changed = true;
+            }
+        }
+}
+
+void fan_model::save ()
+{
+    if (fn.empty () || !changed)
+        return;
+    const std::string tmp = fn + "." + std::to_string (getpid ()) + ".tmp";
+    const int fd = open (tmp.c_str (), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1)
+        throw std::runtime_error ("could not open " + tmp);
+    fan_header h { FAN_MAGIC, FAN_VERSION, uint32_t (envelopes.size ()), 0 };
+    const size_t n = envelopes.size () * sizeof (fan_envelope);
+    const bool ok = write (fd, &h, sizeof (h)) == sizeof (h)
+        && (n == 0 || write (fd, &envelopes[0], n) == ssize_t (n));
+    close (fd);
+    if (!ok)
+    {
+        unlink (tmp.c_str ());
+        throw std::runtime_error ("could not write " + tmp);
+    }
+    if (rename (tmp.c_str (), fn.c_str ()))
+        throw std::runtime_error ("could not rename " + tmp + " to " + fn);
+    changed = false;
+}
+
+} // namespace therm
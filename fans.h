@@ -0,0 +1,161 @@
+/// @file fans.h
+/// @brief learned fan speed envelopes
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef FANS_H
+#define FANS_H
+
+#include "therm.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief fan model file identification
+const uint32_t FAN_MAGIC = 0x74686666;
+const uint32_t FAN_VERSION = 1;
+
+/// @brief weight of the past in each update, so the model follows slow
+/// changes, like the seasons
+const double FAN_DECAY = 0.9999;
+
+/// @brief weighted samples a fan needs before it is judged
+const double FAN_MIN_SAMPLES = 100;
+
+/// @brief a fan slower than this fraction of its expected speed is degraded
+const double FAN_DEGRADED = 0.7;
+
+/// @brief a fan faster than this fraction of its highest speed is at its
+/// maximum, which is pinned if it is expected to be below FAN_PINNED_EXPECTED
+/// of it
+const double FAN_PINNED = 0.95;
+const double FAN_PINNED_EXPECTED = 0.8;
+
+/// @brief ms between saves of the model by programs that keep running
+const uint64_t FAN_SAVE_INTERVAL = 600000;
+
+/// @brief health of a fan
+enum fan_health
+{
+    /// @brief not enough samples to tell
+    HEALTH_LEARNING,
+    HEALTH_OK,
+    /// @brief not turning, though it always has been
+    HEALTH_STALLED,
+    /// @brief much slower than usual at this temperature
+    HEALTH_DEGRADED,
+    /// @brief at full speed, though it is usually much slower at this
+    /// temperature
+    HEALTH_PINNED
+};
+
+/// @brief get the name of a fan health
+///
+/// @param h the health
+///
+/// @return the name
+const char *get_name (fan_health h);
+
+/// @brief what has been learned about a fan
+struct fan_envelope
+{
+    /// @brief hash of the fan's name
+    uint64_t key;
+    /// @brief lowest speed above 0 and highest speed seen
+    float min;
+    float max;
+    /// @brief weighted sums for the regression of the speed on the hottest
+    /// temperature of its chip
+    double n, sx, sy, sxx, sxy;
+    /// @brief true if it was seen stopped while learning, as fans with a
+    /// zero speed mode are
+    uint32_t stops;
+    uint32_t reserved;
+};
+
+/// @brief learned fan speed envelopes
+///
+/// For each fan, the model keeps the range of speeds it has been seen at,
+/// and a running linear regression of its speed on the hottest temperature
+/// of its chip, so it knows how fast the fan usually turns at the current
+/// temperature.  The fans' healths are judged against that, and only
+/// healthy samples are learned, so a failing fan doesn't teach the model
+/// that failing is normal.
+///
+/// The model is kept in a small file of fixed size records, read with mmap
+/// and replaced by renaming a temporary file.  Removing the file makes it
+/// start over, as after replacing a fan with a different one.
+class fan_model
+{
+    public:
+    /// @brief constructor
+    ///
+    /// A missing or unreadable file is the same as an empty model.
+    ///
+    /// @param fn model filename, or empty to not keep the model
+    fan_model (const std::string &fn);
+    /// @brief learn from a snapshot and judge its fans
+    ///
+    /// @param bs vector of bus sensor data
+    void update (const busses &bs);
+    /// @brief get the health of each fan in the last snapshot
+    ///
+    /// @return the healths, in the order of the fans in the snapshot
+    const std::vector<uint8_t> &get_health () const { return health; }
+    /// @brief get the speeds the fans were expected to have
+    ///
+    /// @return the speeds, in the order of the fans in the snapshot, or 0
+    /// while learning
+    const std::vector<double> &get_expected () const { return expected; }
+    /// @brief get the highest speed of each fan
+    ///
+    /// @return the speeds, in the order of the fans in the snapshot, or 0
+    /// if unknown
+    const std::vector<double> &get_max () const { return max; }
+    /// @brief write the model if it learned anything, unless it has no
+    /// filename
+    void save ();
+    private:
+    /// @brief find a fan's envelope, adding it if it is new
+    ///
+    /// @param key the fan's key
+    ///
+    /// @return its index
+    size_t find (uint64_t key);
+    std::string fn;
+    /// @brief true if the model learned something since it was read or
+    /// written
+    bool changed;
+    /// @brief envelopes sorted by key
+    std::vector<fan_envelope> envelopes;
+    /// @brief envelope of each fan in the snapshot, looked up when the
+    /// topology changes
+    std::vector<std::string> names;
+    std::vector<size_t> indices;
+    std::vector<uint8_t> health;
+    std::vector<double> expected;
+    std::vector<double> max;
+};
+
+} // namespace therm
+
+#endif
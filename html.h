@@ -0,0 +1,436 @@
+/// @file html.h
+/// @brief static html status page
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HTML_H
+#define HTML_H
+
+#include "options.h"
+#include "shm.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace therm
+{
+
+/// @brief number of samples shown in the history graphs
+const size_t HTML_HISTORY = 300;
+
+/// @brief write snapshots to a self contained html page
+///
+/// The page has a bar for each sensor and a history graph for each chip,
+/// drawn with inline svg, and reloads itself every interval.  It is only
+/// written when a value changes, and it is written to a temporary file and
+/// renamed, so a web server never serves a partial page.
+class html_page
+{
+    private:
+    const options &opts;
+    std::string fn;
+    std::string title;
+    unsigned interval;
+    /// @brief the last snapshot written
+    busses last;
+    /// @brief circular buffer of samples, each holding the temperatures
+    /// and then the fan speeds in snapshot order
+    std::vector<float> history;
+    std::vector<uint64_t> times;
+    size_t sensors, samples, head;
+    /// @brief page text, reused between writes
+    std::ostringstream page;
+    /// @brief check if two snapshots have the same sensors
+    ///
+    /// @param a first snapshot
+    /// @param b second snapshot
+    ///
+    /// @return true if they do
+    static bool same_topology (const busses &a, const busses &b)
+    {
+        if (a.size () != b.size ())
+            return false;
+        for (size_t i = 0; i < a.size (); ++i)
+        {
+            if (a[i].name != b[i].name || a[i].chips.size () != b[i].chips.size ())
+                return false;
+            for (size_t j = 0; j < a[i].chips.size (); ++j)
+            {
+                const chip &x = a[i].chips[j];
+                const chip &y = b[i].chips[j];
+                if (x.name != y.name || x.temps.size () != y.temps.size () || x.fan_speeds.size () != y.fan_speeds.size ()
+                    || x.measurements.size () != y.measurements.size ())
+                    return false;
+                for (size_t k = 0; k < x.temps.size (); ++k)
+                    if (x.temps[k].label != y.temps[k].label || x.temps[k].high != y.temps[k].high || x.temps[k].critical != y.temps[k].critical)
+                        return false;
+                for (size_t k = 0; k < x.fan_speeds.size (); ++k)
+                    if (x.fan_speeds[k].label != y.fan_speeds[k].label)
+                        return false;
+                for (size_t k = 0; k < x.measurements.size (); ++k)
+                    if (x.measurements[k].label != y.measurements[k].label || x.measurements[k].kind != y.measurements[k].kind)
+                        return false;
+            }
+        }
+        return true;
+    }
+    /// @brief check if two snapshots of the same topology have the same values
+    ///
+    /// @param a first snapshot
+    /// @param b second snapshot
+    ///
+    /// @return true if they do
+    static bool same_values (const busses &a, const busses &b)
+    {
+        for (size_t i = 0; i < a.size (); ++i)
+            for (size_t j = 0; j < a[i].chips.size (); ++j)
+            {
+                const chip &x = a[i].chips[j];
+                const chip &y = b[i].chips[j];
+                for (size_t k = 0; k < x.temps.size (); ++k)
+                    if (x.temps[k].current != y.temps[k].current)
+                        return false;
+                for (size_t k = 0; k < x.fan_speeds.size (); ++k)
+                    if (x.fan_speeds[k].current != y.fan_speeds[k].current)
+                        return false;
+                for (size_t k = 0; k < x.measurements.size (); ++k)
+                    if (x.measurements[k].current != y.measurements[k].current)
+                        return false;
+            }
+        return true;
+    }
+    /// @brief get a sample from the history
+    ///
+    /// @param i sample index, oldest first
+    ///
+    /// @return the sample's values
+    const float *sample (size_t i) const
+    {
+        return &history[((head + HTML_HISTORY - samples + i) % HTML_HISTORY) * sensors];
+    }
+    /// @brief escape text for html
+    ///
+    /// @param s the text
+    ///
+    /// @return the escaped text
+    static std::string escape (const std::string &s)
+    {
+        std::string e;
+        for (auto c : s)
+        {
+            switch (c)
+            {
+                case '<': e += "&lt;"; break;
+                case '>': e += "&gt;"; break;
+                case '&': e += "&amp;"; break;
+                case '"': e += "&quot;"; break;
+                default: e += c; break;
+            }
+        }
+        return e;
+    }
+    /// @brief convert a temperature to the configured scale
+    ///
+    /// @param c temperature in celsius
+    ///
+    /// @return the temperature
+    double scale (double c) const
+    {
+        return opts.get_fahrenheit () ? ctof (c) : c;
+    }
+    /// @brief draw a temperature bar, colored like the console bars
+    ///
+    /// @param t temperature
+    void temp_bar (temperature t)
+    {
+        // set default temps if none were given
+        if (t.high == -1)
+            t.high = 80;
+        if (t.critical == -1)
+            t.critical = 90;
+        const double MIN = 40;
+        const double MAX = t.critical + 5;
+        const double W = 300;
+        const double current = std::max (MIN, std::min (MAX, t.current));
+        const double high = W * (t.high - MIN) / (MAX - MIN);
+        const double critical = W * (t.critical - MIN) / (MAX - MIN);
+        const char *fill = t.current >= t.critical ? "#d22" : (t.current >= t.high ? "#db2" : "#2a2");
+        page << "<svg width=\"" << W << "\" height=\"14\">"
+            << "<rect width=\"" << high << "\" height=\"14\" fill=\"#cec\"/>"
+            << "<rect x=\"" << high << "\" width=\"" << critical - high << "\" height=\"14\" fill=\"#eec\"/>"
+            << "<rect x=\"" << critical << "\" width=\"" << W - critical << "\" height=\"14\" fill=\"#ecc\"/>"
+            << "<rect width=\"" << W * (current - MIN) / (MAX - MIN) << "\" height=\"14\" fill=\"" << fill << "\"/>"
+            << "</svg>";
+    }
+    /// @brief draw a fan speed bar
+    ///
+    /// @param f fan speed
+    /// @param max the speed of a full bar
+    void speed_bar (const fan_speed &f, double max)
+    {
+        const double W = 300;
+        const double current = std::max (0.0, std::min (max, f.current));
+        page << "<svg width=\"" << W << "\" height=\"14\">"
+            << "<rect width=\"" << W << "\" height=\"14\" fill=\"#cce\"/>"
+            << "<rect width=\"" << W * current / max << "\" height=\"14\" fill=\"#22c\"/>"
+            << "</svg>";
+    }
+    /// @brief get the color of a sensor's graph line
+    ///
+    /// @param k index of the sensor in its chip's graph
+    ///
+    /// @return the color
+    static const char *color (size_t k)
+    {
+        static const char *colors[] = { "#e41a1c", "#377eb8", "#4daf4a", "#984ea3", "#ff7f00", "#a65628", "#f781bf", "#999999" };
+        return colors[k % 8];
+    }
+    /// @brief draw the history of some sensors
+    ///
+    /// @param first index of the first sensor in a sample
+    /// @param n number of sensors
+    /// @param temps true if they are temperatures
+    void graph (size_t first, size_t n, bool temps)
+    {
+        if (n == 0 || samples < 2)
+            return;
+        float lo = sample (0)[first];
+        float hi = lo;
+        for (size_t i = 0; i < samples; ++i)
+            for (size_t k = first; k < first + n; ++k)
+            {
+                lo = std::min (lo, sample (i)[k]);
+                hi = std::max (hi, sample (i)[k]);
+            }
+        if (hi - lo < 1)
+        {
+            lo -= 0.5f;
+            hi += 0.5f;
+        }
+        const double W = 600;
+        const double H = 100;
+        const double t0 = times[(head + HTML_HISTORY - samples) % HTML_HISTORY];
+        const double t1 = times[(head + HTML_HISTORY - 1) % HTML_HISTORY];
+        const double span = std::max (1.0, t1 - t0);
+        page << "<svg width=\"" << W << "\" height=\"" << H + 14 << "\">"
+            << "<rect width=\"" << W << "\" height=\"" << H << "\" fill=\"#f8f8f8\" stroke=\"#ccc\"/>";
+        for (size_t k = 0; k < n; ++k)
+        {
+            page << "<polyline fill=\"none\" stroke-width=\"1.5\" stroke=\"" << color (k) << "\" points=\"";
+            for (size_t i = 0; i < samples; ++i)
+            {
+                const double x = W * (times[(head + HTML_HISTORY - samples + i) % HTML_HISTORY] - t0) / span;
+                const double y = H - H * (sample (i)[first + k] - lo) / (hi - lo);
+                page << x << ',' << y << ' ';
+            }
+            page << "\"/>";
+        }
+        page << "<text x=\"2\" y=\"" << H + 12 << "\" font-size=\"11\">"
+            << round (temps ? scale (lo) : lo) << " to " << round (temps ? scale (hi) : hi)
+            << (temps ? (opts.get_fahrenheit () ? "F" : "C") : " RPM")
+            << " over " << round (span / 1000) << "s</text></svg>";
+    }
+    /// @brief draw the page
+    void render ()
+    {
+        page.str ("");
+        const unsigned refresh = std::max (1u, (interval + 999) / 1000);
+        const char unit = opts.get_fahrenheit () ? 'F' : 'C';
+        page << "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\">"
+            << "<meta http-equiv=\"refresh\" content=\"" << refresh << "\">"
+            << "<title>" << escape (title) << "</title>"
+            << "<style>body{font-family:sans-serif}td{padding:0 6px}.chip{margin-bottom:1em}</style>"
+            << "</head><body>\n<h2>" << escape (title) << "</h2>\n";
+        // largest fan speed seen, to scale the fan bars
+        double max_speed = 1000;
+        size_t first = 0;
+        for (auto &b : last)
+            for (auto &c : b.chips)
+            {
+                first += c.temps.size ();
+                for (size_t k = 0; k < c.fan_speeds.size (); ++k)
+                    for (size_t i = 0; i < samples; ++i)
+                        max_speed = std::max<double> (max_speed, sample (i)[first + k]);
+                first += c.fan_speeds.size ();
+            }
+        first = 0;
+        for (auto &b : last)
+        {
+            page << "<h3>[" << b.id << "] " << escape (b.name) << "</h3>\n";
+            for (auto &c : b.chips)
+            {
+                page << "<div class=\"chip\"><b>" << escape (c.name) << "</b><table>\n";
+                for (size_t k = 0; k < c.temps.size (); ++k)
+                {
+                    const temperature &t = c.temps[k];
+                    page << "<tr><td style=\"color:" << color (k) << "\">" << escape (t.label) << "</td><td align=\"right\">"
+                        << round (scale (t.current)) << unit << "</td><td>";
+                    temp_bar (t);
+                    page << "</td></tr>\n";
+                }
+                for (size_t k = 0; k < c.fan_speeds.size (); ++k)
+                {
+                    const fan_speed &f = c.fan_speeds[k];
+                    page << "<tr><td style=\"color:" << color (k) << "\">" << escape (f.label) << "</td><td align=\"right\">"
+                        << round (f.current) << " RPM</td><td>";
+                    speed_bar (f, max_speed);
+                    page << "</td></tr>\n";
+                }
+                for (auto &m : c.measurements)
+                    page << "<tr><td>" << escape (m.label) << "</td><td align=\"right\">" << format (m) << "</td><td></td></tr>\n";
+                page << "</table>\n";
+                graph (first, c.temps.size (), true);
+                first += c.temps.size ();
+                graph (first, c.fan_speeds.size (), false);
+                first += c.fan_speeds.size ();
+                page << "</div>\n";
+            }
+        }
+        const time_t now = times[(head + HTML_HISTORY - 1) % HTML_HISTORY] / 1000;
+        char when[64];
+        strftime (when, sizeof (when), "%Y-%m-%d %H:%M:%S", localtime (&now));
+        page << "<p><small>therm version " << MAJOR_REVISION << '.' << MINOR_REVISION
+            << ", updated " << when << "</small></p>\n</body></html>\n";
+    }
+    /// @brief write the page
+    void write ()
+    {
+        const std::string tmp = fn + "." + std::to_string (getpid ()) + ".tmp";
+        {
+            std::ofstream ofs (tmp.c_str ());
+            if (!ofs)
+                throw std::runtime_error ("could not open " + tmp + " for writing");
+            const std::string s = page.str ();
+            ofs.write (s.data (), s.size ());
+            if (!ofs)
+                throw std::runtime_error ("could not write " + tmp);
+        }
+        if (rename (tmp.c_str (), fn.c_str ()) == -1)
+            throw std::runtime_error ("could not rename " + tmp + " to " + fn);
+    }
+    public:
+    /// @brief constructor
+    ///
+    /// @param opts configuration options
+    /// @param fn page filename
+    /// @param title page title
+    /// @param interval sampling interval in ms
+    html_page (const options &opts, const std::string &fn, const std::string &title, unsigned interval)
+        : opts (opts)
+        , fn (fn)
+        , title (title)
+        , interval (interval)
+        , times (HTML_HISTORY)
+        , sensors (0)
+        , samples (0)
+        , head (0)
+    {
+    }
+    /// @brief start the graphs from a published history, and write the page
+    ///
+    /// @param bs the snapshot the history goes with
+    /// @param h history, oldest sample first, with values in the same
+    /// order as the sensors in the snapshot
+    void seed (const busses &bs, const std::vector<shm_sample> &h)
+    {
+        size_t ntemps = 0, nfans = 0;
+        for (auto &b : bs)
+            for (auto &c : b.chips)
+            {
+                ntemps += c.temps.size ();
+                nfans += c.fan_speeds.size ();
+            }
+        if (ntemps > SHM_MAX_TEMPS || nfans > SHM_MAX_FANS)
+            return;
+        sensors = ntemps + nfans;
+        history.assign (HTML_HISTORY * sensors, 0);
+        samples = head = 0;
+        // only the latest samples fit
+        const size_t first = h.size () > HTML_HISTORY ? h.size () - HTML_HISTORY : 0;
+        for (size_t i = first; i < h.size (); ++i)
+        {
+            float *s = &history[head * sensors];
+            size_t t = 0, f = 0;
+            for (auto &b : bs)
+                for (auto &c : b.chips)
+                {
+                    for (size_t k = 0; k < c.temps.size (); ++k)
+                        *s++ = h[i].temps[t++];
+                    for (size_t k = 0; k < c.fan_speeds.size (); ++k)
+                        *s++ = h[i].fans[f++];
+                }
+            times[head] = h[i].time;
+            head = (head + 1) % HTML_HISTORY;
+            samples = std::min (samples + 1, HTML_HISTORY);
+        }
+        if (samples == 0)
+            return;
+        last = bs;
+        render ();
+        write ();
+    }
+    /// @brief add a snapshot, and write the page if anything changed
+    ///
+    /// @param bs vector of bus sensor data
+    /// @param time sample time in ms since the epoch
+    ///
+    /// @return true if the page was written
+    bool update (const busses &bs, uint64_t time)
+    {
+        const bool same = same_topology (bs, last);
+        const bool changed = !same || !same_values (bs, last);
+        // start a new history when the sensors change
+        if (!same)
+        {
+            sensors = 0;
+            for (auto &b : bs)
+                for (auto &c : b.chips)
+                    sensors += c.temps.size () + c.fan_speeds.size ();
+            history.assign (HTML_HISTORY * sensors, 0);
+            samples = head = 0;
+        }
+        float *s = sensors ? &history[head * sensors] : nullptr;
+        for (auto &b : bs)
+            for (auto &c : b.chips)
+            {
+                for (auto &t : c.temps)
+                    *s++ = t.current;
+                for (auto &f : c.fan_speeds)
+                    *s++ = f.current;
+            }
+        times[head] = time;
+        head = (head + 1) % HTML_HISTORY;
+        samples = std::min (samples + 1, HTML_HISTORY);
+        if (!changed)
+            return false;
+        last = bs;
+        render ();
+        write ();
+        return true;
+    }
+};
+
+} // namespace therm
+
+#endif
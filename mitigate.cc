@@ -0,0 +1,332 @@
+/// @file mitigate.cc
+/// @brief built in actions that cool the processors down
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mitigate.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace therm
+{
+
+bool parse_action (const std::string &command, action &a)
+{
+    std::istringstream ss (command);
+    std::string name;
+    ss >> name;
+    if (name != "cap_freq" && name != "cpu_max")
+        return false;
+    auto fail = [&] (const std::string &why)
+    {
+        throw std::runtime_error ("action '" + command + "': " + why);
+    };
+    std::vector<std::string> args;
+    std::string word;
+    while (ss >> word && word != "until")
+        args.push_back (word);
+    if (word == "until")
+    {
+        getline (ss, a.until);
+        a.until.erase (0, a.until.find_first_not_of (" \t"));
+        if (a.until.empty ())
+            fail ("expected an expression after 'until'");
+    }
+    else
+        a.until.clear ();
+    if (name == "cap_freq")
+    {
+        a.type = CAP_FREQ;
+        char *end = nullptr;
+        if (args.size () == 1)
+            a.ghz = strtod (args[0].c_str (), &end);
+        if (args.size () != 1 || *end != 0 || !(a.ghz > 0))
+            fail ("expected 'cap_freq GHZ'");
+    }
+    else
+    {
+        a.type = CPU_MAX;
+        if (args.size () < 2 || args.size () > 3)
+            fail ("expected 'cpu_max CGROUP QUOTA [PERIOD]'");
+        for (size_t i = 1; i < args.size (); ++i)
+            if (!(i == 1 && args[i] == "max") && args[i].find_first_not_of ("0123456789") != std::string::npos)
+                fail ("'" + args[i] + "' is not a number of us");
+        if (args[0].find ("..") != std::string::npos)
+            fail ("'" + args[0] + "' is not a cgroup");
+        a.cgroup = args[0];
+        a.quota = args[1] + (args.size () == 3 ? " " + args[2] : std::string ());
+    }
+    return true;
+}
+
+/// @brief read a sysfs or cgroup file
+///
+/// @param path the file
+/// @param value its first line
+///
+/// @return false if it could not be read
+static bool read_file (const std::string &path, std::string &value)
+{
+    std::ifstream ifs (path.c_str ());
+    return static_cast<bool> (getline (ifs, value));
+}
+
+/// @brief write a sysfs or cgroup file
+///
+/// @param path the file
+/// @param value the value
+///
+/// @return false if the value was not accepted
+static bool write_file (const std::string &path, const std::string &value)
+{
+    const int fd = open (path.c_str (), O_WRONLY | O_TRUNC | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+    const bool ok = write (fd, value.c_str (), value.size ()) == ssize_t (value.size ());
+    close (fd);
+    return ok;
+}
+
+mitigator::mitigator (const std::string &journal_fn, const std::string &cpu_dir, const std::string &cgroup_dir)
+    : journal_fn (journal_fn)
+    , cpu_dir (cpu_dir)
+    , cgroup_dir (cgroup_dir)
+{
+    // the journal is replaced by renaming, so lock a file beside it
+    const std::string lock_fn = journal_fn + ".lock";
+    lock_fd = open (lock_fn.c_str (), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lock_fd == -1)
+        throw std::runtime_error ("could not open " + lock_fn);
+    if (flock (lock_fd, LOCK_EX | LOCK_NB) == -1)
+    {
+        close (lock_fd);
+        throw std::runtime_error ("another thermalert is applying actions with " + journal_fn);
+    }
+    // put back what a previous run left changed
+    std::ifstream ifs (journal_fn.c_str ());
+    std::string line;
+    while (getline (ifs, line))
+    {
+        const size_t space = line.find (' ');
+        if (space != std::string::npos)
+            unrestored.push_back (change { line.substr (0, space), line.substr (space + 1), std::vector<size_t> () });
+    }
+    if (!unrestored.empty ())
+        restore ();
+}
+
+mitigator::~mitigator ()
+{
+    undo_all ();
+    close (lock_fd);
+}
+
+void mitigator::restore ()
+{
+    std::vector<change> left;
+    for (auto &c : unrestored)
+    {
+        if (write_file (c.path, c.original))
+            std::clog << "restored " << c.path << " to '" << c.original << "'" << std::endl;
+        else
+        {
+            std::clog << "could not restore " << c.path << " to '" << c.original << "'" << std::endl;
+            left.push_back (c);
+        }
+    }
+    unrestored.swap (left);
+    write_journal ();
+}
+
+void mitigator::apply (size_t id, const action &a, const busses &bs)
+{
+    if (a.type == CPU_MAX)
+    {
+        set (id, cgroup_dir + "/" + a.cgroup + "/cpu.max", a.quota);
+        return;
+    }
+    // the packages with a temperature at or above its high limit
+    std::set<int> hot;
+    for (auto &b : bs)
+    {
+        int n = 0;
+        for (auto &c : b.chips)
+        {
+            if (c.name != CORETEMP_CHIP)
+                continue;
+            const int package = get_package (c);
+            for (auto &t : c.temps)
+                if (t.high > 0 && t.current >= t.high)
+                    hot.insert (package == -1 ? n : package);
+            ++n;
+        }
+    }
+    // or all of them if none are
+    DIR *d = opendir (cpu_dir.c_str ());
+    if (d == nullptr)
+        return;
+    std::vector<std::string> cpus;
+    while (dirent *e = readdir (d))
+        if (strncmp (e->d_name, "cpu", 3) == 0 && isdigit (e->d_name[3]))
+            cpus.push_back (cpu_dir + "/" + e->d_name);
+    closedir (d);
+    std::sort (cpus.begin (), cpus.end ());
+    const long cap = lround (a.ghz * 1e6);
+    for (auto &cpu : cpus)
+    {
+        std::string package;
+        if (!hot.empty () && (!read_file (cpu + "/topology/physical_package_id", package) || !hot.count (atoi (package.c_str ()))))
+            continue;
+        // never raise the limit
+        const std::string path = cpu + "/cpufreq/scaling_max_freq";
+        std::string current;
+        if (!read_file (path, current))
+            continue;
+        set (id, path, std::to_string (std::min (cap, atol (current.c_str ()))));
+    }
+}
+
+void mitigator::set (size_t id, const std::string &path, const std::string &value)
+{
+    auto c = std::find_if (changes.begin (), changes.end (), [&] (const change &x) { return x.path == path; });
+    std::string original;
+    if (c == changes.end ())
+    {
+        // a file that couldn't be put back has its original value
+        // in the journal already
+        auto u = std::find_if (unrestored.begin (), unrestored.end (), [&] (const change &x) { return x.path == path; });
+        if (u != unrestored.end ())
+        {
+            original = u->original;
+            unrestored.erase (u);
+        }
+        else if (!read_file (path, original))
+        {
+            std::clog << "could not read " << path << std::endl;
+            return;
+        }
+        // journal the original before changing it
+        changes.push_back (change { path, original, std::vector<size_t> () });
+        write_journal ();
+        c = changes.end () - 1;
+    }
+    if (!write_file (path, value))
+    {
+        std::clog << "could not set " << path << " to '" << value << "'" << std::endl;
+        if (c->ids.empty ())
+        {
+            changes.erase (c);
+            write_journal ();
+        }
+        return;
+    }
+    std::clog << "set " << path << " to '" << value << "', was '" << c->original << "'" << std::endl;
+    if (std::find (c->ids.begin (), c->ids.end (), id) == c->ids.end ())
+        c->ids.push_back (id);
+}
+
+void mitigator::undo (size_t id)
+{
+    bool changed = false;
+    for (auto c = changes.begin (); c != changes.end (); )
+    {
+        auto i = std::find (c->ids.begin (), c->ids.end (), id);
+        if (i == c->ids.end ())
+        {
+            ++c;
+            continue;
+        }
+        c->ids.erase (i);
+        // other actions still want it changed
+        if (!c->ids.empty ())
+        {
+            ++c;
+            continue;
+        }
+        if (write_file (c->path, c->original))
+            std::clog << "restored " << c->path << " to '" << c->original << "'" << std::endl;
+        else
+        {
+            // keep it in the journal, to try again at exit or next run
+            std::clog << "could not restore " << c->path << " to '" << c->original << "'" << std::endl;
+            unrestored.push_back (change { c->path, c->original, std::vector<size_t> () });
+        }
+        c = changes.erase (c);
+        changed = true;
+    }
+    if (changed)
+        write_journal ();
+}
+
+void mitigator::undo_all ()
+{
+    while (!changes.empty ())
+        undo (changes.front ().ids.front ());
+    if (!unrestored.empty ())
+        restore ();
+}
+
+bool mitigator::is_applied (size_t id) const
+{
+    for (auto &c : changes)
+        if (std::find (c.ids.begin (), c.ids.end (), id) != c.ids.end ())
+            return true;
+    return false;
+}
+
+void mitigator::write_journal () const
+{
+    if (changes.empty () && unrestored.empty ())
+    {
+        unlink (journal_fn.c_str ());
+        return;
+    }
+    // this runs while undoing, at exit, so it mustn't throw
+    const std::string tmp = journal_fn + "." + std::to_string (getpid ()) + ".tmp";
+    {
+        std::ofstream ofs (tmp.c_str ());
+        for (auto &c : unrestored)
+            ofs << c.path << ' ' << c.original << std::endl;
+        for (auto &c : changes)
+            ofs << c.path << ' ' << c.original << std::endl;
+        if (!ofs)
+        {
+            std::clog << "could not write " << tmp << std::endl;
+            unlink (tmp.c_str ());
+            return;
+        }
+    }
+    if (rename (tmp.c_str (), journal_fn.c_str ()))
+    {
+        std::clog << "could not rename " << tmp << " to " << journal_fn << std::endl;
+        unlink (tmp.c_str ());
+    }
+}
+
+} // namespace therm
@@ -0,0 +1,150 @@
+/// @file mitigate.h
+/// @brief built in actions that cool the processors down
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef MITIGATE_H
+#define MITIGATE_H
+
+#include "cpufreq.h"
+#include "top.h"
+#include <string>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief kinds of built in actions
+enum action_type
+{
+    CAP_FREQ,
+    CPU_MAX
+};
+
+/// @brief a built in action
+///
+/// Written in place of a rule's command as
+///
+///     cap_freq GHZ [until EXPRESSION]
+///     cpu_max CGROUP QUOTA [PERIOD] [until EXPRESSION]
+///
+/// cap_freq lowers the scaling_max_freq of the cpus of the hot packages,
+/// cpu_max writes the cpu.max of a cgroup.  Both are undone when the rule
+/// clears, or when the 'until' expression becomes true, which gives them
+/// hysteresis.
+struct action
+{
+    int type;
+    /// @brief the cap for CAP_FREQ, in GHz
+    double ghz;
+    /// @brief the cgroup for CPU_MAX, relative to the cgroup root
+    std::string cgroup;
+    /// @brief the cpu.max value for CPU_MAX
+    std::string quota;
+    /// @brief when to undo it, or empty for when the rule clears
+    std::string until;
+};
+
+/// @brief parse a rule's command as an action
+///
+/// @param command the command
+/// @param a the action
+///
+/// @return false if the command isn't a built in action
+bool parse_action (const std::string &command, action &a);
+
+/// @brief apply and undo built in actions
+///
+/// Each sysfs or cgroup file that an action changes, and the value it had
+/// before, is recorded in a journal file before it is changed, and removed
+/// from the journal when the value is put back.  A file that several actions
+/// changed is put back when the last of them is undone.  If the journal
+/// isn't empty at construction, a previous run didn't get to undo its
+/// actions, and they are undone then.  Files that can't be put back stay in
+/// the journal.  Everything is undone at destruction.  Every change is
+/// logged.
+///
+/// Only one mitigator can use a journal at a time, so one can't undo what
+/// another has applied.
+class mitigator
+{
+    public:
+    /// @brief constructor
+    ///
+    /// @param journal_fn journal file
+    /// @param cpu_dir cpu sysfs directory
+    /// @param cgroup_dir cgroup directory
+    ///
+    /// Throws if another mitigator is using the journal.
+    mitigator (const std::string &journal_fn, const std::string &cpu_dir = CPU_DIR, const std::string &cgroup_dir = CGROUP_DIR);
+    /// @brief destructor
+    ~mitigator ();
+    mitigator (const mitigator &) = delete;
+    mitigator &operator= (const mitigator &) = delete;
+    /// @brief apply an action
+    ///
+    /// @param id identifies the action when undoing it
+    /// @param a the action
+    /// @param bs the snapshot that triggered it, which tells which packages are hot
+    void apply (size_t id, const action &a, const busses &bs);
+    /// @brief undo an action
+    ///
+    /// @param id the action
+    void undo (size_t id);
+    /// @brief undo all actions
+    void undo_all ();
+    /// @brief check if an action is applied
+    ///
+    /// @param id the action
+    ///
+    /// @return true if it is
+    bool is_applied (size_t id) const;
+    private:
+    /// @brief a changed file
+    struct change
+    {
+        std::string path;
+        /// @brief the value before the first change
+        std::string original;
+        /// @brief the actions that changed it
+        std::vector<size_t> ids;
+    };
+    /// @brief change a file
+    ///
+    /// @param id the action
+    /// @param path the file
+    /// @param value the new value
+    void set (size_t id, const std::string &path, const std::string &value);
+    /// @brief try again to put back the files that couldn't be
+    void restore ();
+    /// @brief rewrite the journal, logging if it can't be
+    void write_journal () const;
+    std::string journal_fn;
+    std::string cpu_dir;
+    std::string cgroup_dir;
+    /// @brief lock on the journal, held for the mitigator's lifetime
+    int lock_fd;
+    std::vector<change> changes;
+    /// @brief files that couldn't be put back, by this run or a previous one
+    std::vector<change> unrestored;
+};
+
+} // namespace therm
+
+#endif
@@ -0,0 +1,220 @@
+/// @file net.cc
+/// @brief socket helpers
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "net.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace therm
+{
+
+/// @brief check if an address is a unix socket path
+///
+/// @param addr the address
+///
+/// @return true if it is
+static bool is_unix (const std::string &addr)
+{
+    return addr.find ('/') != std::string::npos;
+}
+
+/// @brief fill in a unix socket address
+///
+/// @param addr the path
+/// @param sa the socket address
+static void get_unix_address (const std::string &addr, sockaddr_un &sa)
+{
+    if (addr.size () >= sizeof (sa.sun_path))
+        throw std::runtime_error ("unix socket path is too long: " + addr);
+    memset (&sa, 0, sizeof (sa));
+    sa.sun_family = AF_UNIX;
+    memcpy (sa.sun_path, addr.c_str (), addr.size ());
+}
+
+/// @brief resolve a tcp address
+///
+/// @param addr the address
+/// @param passive true to get an address to listen on
+///
+/// @return the address list, free with freeaddrinfo ()
+static addrinfo *get_tcp_address (const std::string &addr, bool passive)
+{
+    const size_t colon = addr.rfind (':');
+    if (colon == std::string::npos)
+        throw std::runtime_error ("address must be host:port or a unix socket path: " + addr);
+    const std::string host = addr.substr (0, colon);
+    const std::string port = addr.substr (colon + 1);
+    addrinfo hints;
+    memset (&hints, 0, sizeof (hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (passive)
+        hints.ai_flags = AI_PASSIVE;
+    addrinfo *ai;
+    const int err = getaddrinfo (host.empty () ? nullptr : host.c_str (), port.c_str (), &hints, &ai);
+    if (err)
+        throw std::runtime_error ("could not resolve " + addr + ": " + gai_strerror (err));
+    return ai;
+}
+
+int listen_on (const std::string &addr)
+{
+    if (is_unix (addr))
+    {
+        sockaddr_un sa;
+        get_unix_address (addr, sa);
+        const int fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1)
+            throw std::runtime_error ("could not create socket");
+        unlink (addr.c_str ());
+        if (bind (fd, reinterpret_cast<sockaddr *> (&sa), sizeof (sa)) == -1 || listen (fd, SOMAXCONN) == -1)
+        {
+            close (fd);
+            throw std::runtime_error ("could not listen on " + addr);
+        }
+        return fd;
+    }
+    addrinfo *ai = get_tcp_address (addr, true);
+    for (addrinfo *i = ai; i; i = i->ai_next)
+    {
+        const int fd = socket (i->ai_family, i->ai_socktype | SOCK_CLOEXEC, i->ai_protocol);
+        if (fd == -1)
+            continue;
+        const int one = 1;
+        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+        if (bind (fd, i->ai_addr, i->ai_addrlen) == 0 && listen (fd, SOMAXCONN) == 0)
+        {
+            freeaddrinfo (ai);
+            return fd;
+        }
+        close (fd);
+    }
+    freeaddrinfo (ai);
+    throw std::runtime_error ("could not listen on " + addr);
+}
+
+/// @brief connect a socket, giving up after a while
+///
+/// @param fd the socket
+/// @param sa the address
+/// @param len the address length
+/// @param timeout ms to wait, or -1 to wait as long as the kernel does
+///
+/// @return false if it could not connect
+static bool connect_within (int fd, const sockaddr *sa, socklen_t len, int timeout)
+{
+    if (timeout < 0)
+        return connect (fd, sa, len) == 0;
+    // connect in the background, and wait for it to finish
+    const int flags = fcntl (fd, F_GETFL);
+    if (flags == -1 || fcntl (fd, F_SETFL, flags | O_NONBLOCK) == -1)
+        return false;
+    if (connect (fd, sa, len) == -1)
+    {
+        if (errno != EINPROGRESS)
+            return false;
+        pollfd p { fd, POLLOUT, 0 };
+        int n;
+        while ((n = poll (&p, 1, timeout)) == -1 && errno == EINTR)
+            ;
+        int error = 0;
+        socklen_t size = sizeof (error);
+        if (n != 1 || getsockopt (fd, SOL_SOCKET, SO_ERROR, &error, &size) == -1 || error != 0)
+            return false;
+    }
+    return fcntl (fd, F_SETFL, flags) != -1;
+}
+
+int connect_to (const std::string &addr, int timeout)
+{
+    if (is_unix (addr))
+    {
+        sockaddr_un sa;
+        get_unix_address (addr, sa);
+        const int fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1)
+            throw std::runtime_error ("could not create socket");
+        if (!connect_within (fd, reinterpret_cast<sockaddr *> (&sa), sizeof (sa), timeout))
+        {
+            close (fd);
+            throw std::runtime_error ("could not connect to " + addr);
+        }
+        return fd;
+    }
+    addrinfo *ai = get_tcp_address (addr, false);
+    for (addrinfo *i = ai; i; i = i->ai_next)
+    {
+        const int fd = socket (i->ai_family, i->ai_socktype | SOCK_CLOEXEC, i->ai_protocol);
+        if (fd == -1)
+            continue;
+        if (connect_within (fd, i->ai_addr, i->ai_addrlen, timeout))
+        {
+            freeaddrinfo (ai);
+            // frames are small and should go out right away
+            const int one = 1;
+            setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+            return fd;
+        }
+        close (fd);
+    }
+    freeaddrinfo (ai);
+    throw std::runtime_error ("could not connect to " + addr);
+}
+
+void set_nonblocking (int fd)
+{
+    const int flags = fcntl (fd, F_GETFL);
+    if (flags == -1 || fcntl (fd, F_SETFL, flags | O_NONBLOCK) == -1)
+        throw std::runtime_error ("could not make descriptor non-blocking");
+}
+
+void set_send_timeout (int fd, unsigned ms)
+{
+    timeval tv;
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = (ms % 1000) * 1000;
+    setsockopt (fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof (tv));
+}
+
+bool send_all (int fd, const char *p, size_t n)
+{
+    while (n)
+    {
+        const ssize_t sent = send (fd, p, n, MSG_NOSIGNAL);
+        if (sent == -1 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        p += sent;
+        n -= sent;
+    }
+    return true;
+}
+
+} // namespace therm
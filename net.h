@@ -0,0 +1,74 @@
+/// @file net.h
+/// @brief socket helpers
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef NET_H
+#define NET_H
+
+#include <cstddef>
+#include <string>
+
+namespace therm
+{
+
+/// @brief default collector address
+const char *const DEFAULT_COLLECTOR = ":7634";
+
+/// @brief open a listening socket
+///
+/// Addresses that contain a '/' are unix socket paths.  Others are
+/// 'host:port', or ':port' to listen on all interfaces.
+///
+/// @param addr the address
+///
+/// @return the socket
+int listen_on (const std::string &addr);
+
+/// @brief connect to a socket
+///
+/// @param addr the address, as for listen_on ()
+/// @param timeout ms to wait for the connection, or -1 to wait as long as
+/// the kernel does
+///
+/// @return the socket
+int connect_to (const std::string &addr, int timeout = -1);
+
+/// @brief make a descriptor non-blocking
+///
+/// @param fd the descriptor
+void set_nonblocking (int fd);
+
+/// @brief limit how long a blocking send may take
+///
+/// @param fd the socket
+/// @param ms the limit in ms
+void set_send_timeout (int fd, unsigned ms);
+
+/// @brief send a buffer on a blocking socket
+///
+/// @param fd the socket
+/// @param p the buffer
+/// @param n bytes in the buffer
+///
+/// @return false if the connection failed or the send timed out
+bool send_all (int fd, const char *p, size_t n);
+
+} // namespace therm
+
+#endif
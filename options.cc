@@ -0,0 +1,65 @@
+/// @file options.cc
+/// @brief configuration options
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "options.h"
+
+namespace therm
+{
+
+void read (options &opts, const std::string &fn)
+{
+    std::clog << "reading configuration file " << fn << std::endl;
+    std::ifstream ifs (fn.c_str ());
+    if (!ifs)
+        throw std::runtime_error ("could not open config file for reading");
+    ifs >> opts;
+}
+
+void write (const options &opts, const std::string &fn)
+{
+    std::clog << "writing configuration file " << fn << std::endl;
+    std::ofstream ofs (fn.c_str ());
+    if (!ofs)
+        throw std::runtime_error ("could not open config file for writing");
+    ofs << opts;
+}
+
+std::string get_config_dir ()
+{
+    std::string config_dir;
+    if (getenv ("XDG_CONFIG_HOME"))
+        config_dir = getenv ("XDG_CONFIG_HOME");
+    else if (getenv ("HOME"))
+        config_dir = getenv ("HOME") + std::string ("/.config");
+    else
+        config_dir = "~/.config";
+    config_dir += "/therm";
+    struct stat sb;
+    if (stat (config_dir.c_str (), &sb) == -1)
+    {
+        std::clog << "creating config file directory " << config_dir << std::endl;
+        mkdir (config_dir.c_str (), 0700);
+    }
+    if (stat (config_dir.c_str (), &sb) == -1)
+        throw std::runtime_error ("could not create config file directory");
+    return config_dir;
+}
+
+} // namespace therm
@@ -129,51 +129,18 @@ class options
 ///
 /// @param opts options
 /// @param fn filename
-void read (options &opts, const std::string &fn)
-{
-    std::clog << "reading configuration file " << fn << std::endl;
-    std::ifstream ifs (fn.c_str ());
-    if (!ifs)
-        throw std::runtime_error ("could not open config file for reading");
-    ifs >> opts;
-}
+void read (options &opts, const std::string &fn);
 
 /// @brief helper
 ///
 /// @param opts options
 /// @param fn filename
-void write (const options &opts, const std::string &fn)
-{
-    std::clog << "writing configuration file " << fn << std::endl;
-    std::ofstream ofs (fn.c_str ());
-    if (!ofs)
-        throw std::runtime_error ("could not open config file for writing");
-    ofs << opts;
-}
+void write (const options &opts, const std::string &fn);
 
 /// @brief get the directory of the configuration file, creating the directory if needed
 ///
 /// @return name of the config directory
-std::string get_config_dir ()
-{
-    std::string config_dir;
-    if (getenv ("XDG_CONFIG_HOME"))
-        config_dir = getenv ("XDG_CONFIG_HOME");
-    else if (getenv ("HOME"))
-        config_dir = getenv ("HOME") + std::string ("/.config");
-    else
-        config_dir = "~/.config";
-    config_dir += "/therm";
-    struct stat sb;
-    if (stat (config_dir.c_str (), &sb) == -1)
-    {
-        std::clog << "creating config file directory " << config_dir << std::endl;
-        mkdir (config_dir.c_str (), 0700);
-    }
-    if (stat (config_dir.c_str (), &sb) == -1)
-        throw std::runtime_error ("could not create config file directory");
-    return config_dir;
-};
+std::string get_config_dir ();
 
 } // namespace therm
 
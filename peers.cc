@@ -0,0 +1,150 @@
+/// @file peers.cc
+/// @brief temperatures that stand out from their peers
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "peers.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace therm
+{
+
+/// @brief the scale from a median absolute deviation to a standard
+/// deviation for normally distributed values
+const double MAD_SCALE = 1.4826;
+
+void get_median_mad (const double *x, size_t n, double *scratch, double &median, double &mad)
+{
+    auto mid = [&] ()
+    {
+        // the upper middle, and the lower middle below it if n is even
+        std::nth_element (scratch, scratch + n / 2, scratch + n);
+        const double upper = scratch[n / 2];
+        return n % 2 ? upper : (upper + *std::max_element (scratch, scratch + n / 2)) / 2;
+    };
+    std::copy (x, x + n, scratch);
+    median = mid ();
+    for (size_t i = 0; i < n; ++i)
+        scratch[i] = std::fabs (x[i] - median);
+    mad = mid ();
+}
+
+/// @brief get the part of a label that its peers share
+///
+/// @param label the label
+///
+/// @return the label without a trailing number
+static std::string get_stem (const std::string &label)
+{
+    size_t end = label.size ();
+    while (end > 0 && isdigit (static_cast<unsigned char> (label[end - 1])))
+        --end;
+    while (end > 0 && label[end - 1] == ' ')
+        --end;
+    return label.substr (0, end);
+}
+
+void peer_analysis::update_groups (const busses &bs)
+{
+    size_t n = 0;
+    bool same = true;
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+            for (auto &t : c.temps)
+                same = same && n < labels.size () && labels[n++] == t.label;
+    if (same && n == labels.size ())
+        return;
+    labels.clear ();
+    order.clear ();
+    groups.clear ();
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+        {
+            const uint32_t first = labels.size ();
+            std::vector<std::string> stems;
+            for (auto &t : c.temps)
+            {
+                labels.push_back (t.label);
+                stems.push_back (get_stem (t.label));
+            }
+            // group the chip's temperatures by stem, in order of appearance
+            std::vector<bool> grouped (stems.size ());
+            for (size_t i = 0; i < stems.size (); ++i)
+            {
+                if (grouped[i])
+                    continue;
+                const uint32_t begin = order.size ();
+                for (size_t j = i; j < stems.size (); ++j)
+                    if (!grouped[j] && stems[j] == stems[i])
+                    {
+                        grouped[j] = true;
+                        order.push_back (first + j);
+                    }
+                if (order.size () - begin < PEER_MIN_SIZE)
+                    order.resize (begin);
+                else
+                    groups.push_back (begin);
+            }
+        }
+    groups.push_back (order.size ());
+    values.resize (order.size ());
+    scratch.resize (order.size ());
+}
+
+void peer_analysis::update (const busses &bs)
+{
+    update_groups (bs);
+    deviations.assign (labels.size (), 0);
+    outliers.assign (labels.size (), 0);
+    // gather the values in group order
+    size_t n = 0;
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+            for (auto &t : c.temps)
+                deviations[n++] = t.current;
+    for (size_t k = 0; k < order.size (); ++k)
+        values[k] = deviations[order[k]];
+    deviations.assign (labels.size (), 0);
+    for (size_t g = 0; g + 1 < groups.size (); ++g)
+    {
+        double *x = &values[groups[g]];
+        double *s = &scratch[groups[g]];
+        const size_t size = groups[g + 1] - groups[g];
+        // lost sensors have no value, or -1 if they couldn't be read
+        bool finite = true;
+        for (size_t i = 0; i < size; ++i)
+            finite = finite && std::isfinite (x[i]) && x[i] >= 0;
+        if (!finite)
+            continue;
+        double median, mad;
+        get_median_mad (x, size, s, median, mad);
+        const double limit = std::max (PEER_THRESHOLD * MAD_SCALE * mad, PEER_MIN_DEVIATION);
+        for (size_t i = 0; i < size; ++i)
+            s[i] = x[i] - median;
+        for (size_t i = 0; i < size; ++i)
+        {
+            deviations[order[groups[g] + i]] = s[i];
+            outliers[order[groups[g] + i]] = std::fabs (s[i]) > limit;
+        }
+    }
+}
+
+} // namespace therm
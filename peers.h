@@ -0,0 +1,100 @@
+/// @file peers.h
+/// @brief temperatures that stand out from their peers
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef PEERS_H
+#define PEERS_H
+
+#include "therm.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief how far from its peers' median a temperature has to be to stand
+/// out, in standard deviations estimated from the median absolute deviation
+const double PEER_THRESHOLD = 3.5;
+
+/// @brief and in degrees, so that peers that agree closely don't make every
+/// small difference stand out
+const double PEER_MIN_DEVIATION = 5;
+
+/// @brief groups with fewer temperatures than this have no peers
+const size_t PEER_MIN_SIZE = 3;
+
+/// @brief get the median and the median absolute deviation of some values
+///
+/// @param x the values
+/// @param n how many
+/// @param scratch space for n values
+/// @param median the median
+/// @param mad the median absolute deviation
+void get_median_mad (const double *x, size_t n, double *scratch, double &median, double &mad);
+
+/// @brief find the temperatures that stand out from their peers
+///
+/// The peers of a temperature are the other temperatures on its chip whose
+/// labels are the same apart from a trailing number, like 'Core 0' and
+/// 'Core 1', or 'Tccd1' and 'Tccd2'.  A temperature is an outlier if it is
+/// further from the median of its group than PEER_THRESHOLD times the
+/// median absolute deviation, scaled to a standard deviation, and more than
+/// PEER_MIN_DEVIATION degrees.
+///
+/// The groups are found only when the topology changes.  The values of each
+/// group are gathered into one contiguous array, and the deviations and the
+/// outliers are computed in straight loops over it.
+class peer_analysis
+{
+    public:
+    /// @brief analyze a snapshot
+    ///
+    /// @param bs vector of bus sensor data
+    void update (const busses &bs);
+    /// @brief get how far each temperature is from the median of its peers
+    ///
+    /// @return the deviations, in the order of the temperatures in the
+    /// snapshot, 0 for temperatures without peers
+    const std::vector<double> &get_deviations () const { return deviations; }
+    /// @brief get which temperatures stand out from their peers
+    ///
+    /// @return 1 for outliers, in the order of the temperatures in the snapshot
+    const std::vector<uint8_t> &get_outliers () const { return outliers; }
+    private:
+    /// @brief group the temperatures if the topology changed
+    ///
+    /// @param bs vector of bus sensor data
+    void update_groups (const busses &bs);
+    /// @brief labels of the temperatures, to detect topology changes
+    std::vector<std::string> labels;
+    /// @brief temperature indices, ordered by group
+    std::vector<uint32_t> order;
+    /// @brief where each group starts in order, and where the last ends
+    std::vector<uint32_t> groups;
+    /// @brief the values of a group, and scratch space
+    std::vector<double> values, scratch;
+    std::vector<double> deviations;
+    std::vector<uint8_t> outliers;
+};
+
+} // namespace therm
+
+#endif
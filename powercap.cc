@@ -0,0 +1,156 @@
+/// @file powercap.cc
+/// @brief RAPL energy counters
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "powercap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <time.h>
+#include <unistd.h>
+
+namespace therm
+{
+
+/// @brief get the directories of the RAPL zones
+///
+/// @param dir powercap directory
+/// @param prefix zone name prefix
+///
+/// @return the zone names, sorted
+static std::vector<std::string> get_zones (const std::string &dir, const std::string &prefix)
+{
+    std::vector<std::string> zones;
+    DIR *d = opendir (dir.c_str ());
+    if (d == nullptr)
+        return zones;
+    while (dirent *e = readdir (d))
+    {
+        const std::string name (e->d_name);
+        // 'intel-rapl:0' is a package, 'intel-rapl:0:1' a subzone of it
+        if (name.compare (0, prefix.size (), prefix) == 0
+            && name.find (':', prefix.size ()) == std::string::npos)
+            zones.push_back (name);
+    }
+    closedir (d);
+    std::sort (zones.begin (), zones.end ());
+    return zones;
+}
+
+/// @brief get the monotonic time
+///
+/// @return the time in ns
+static uint64_t now_ns ()
+{
+    timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return uint64_t (ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+powercap::powercap (const std::string &dir)
+{
+    const std::string prefix = std::string (POWERCAP_CHIP) + ":";
+    for (auto &p : get_zones (dir, prefix))
+    {
+        package pkg;
+        open_zone (dir + "/" + p, pkg.zones);
+        // subzones are also linked from the package directory
+        for (auto &z : get_zones (dir + "/" + p, p + ":"))
+            open_zone (dir + "/" + p + "/" + z, pkg.zones);
+        if (!pkg.zones.empty ())
+            packages.push_back (pkg);
+    }
+}
+
+powercap::~powercap ()
+{
+    for (auto &p : packages)
+        for (auto &z : p.zones)
+            close (z.fd);
+}
+
+void powercap::open_zone (const std::string &dir, std::vector<zone> &zones)
+{
+    zone z;
+    std::ifstream name ((dir + "/name").c_str ());
+    std::ifstream range ((dir + "/max_energy_range_uj").c_str ());
+    if (!(name >> z.label) || !(range >> z.range) || z.range == 0)
+        return;
+    z.fd = open ((dir + "/energy_uj").c_str (), O_RDONLY | O_CLOEXEC);
+    if (z.fd == -1)
+        return;
+    // the first power reading is relative to this one
+    if (!read_zone (z, z.energy, z.time))
+    {
+        close (z.fd);
+        return;
+    }
+    zones.push_back (z);
+}
+
+bool powercap::read_zone (const zone &z, uint64_t &energy, uint64_t &time)
+{
+    char buf[32];
+    const ssize_t n = pread (z.fd, buf, sizeof (buf) - 1, 0);
+    if (n <= 0)
+        return false;
+    buf[n] = 0;
+    char *end;
+    energy = strtoull (buf, &end, 10);
+    time = now_ns ();
+    return end != buf;
+}
+
+void powercap::scan (busses &bs)
+{
+    if (packages.empty ())
+        return;
+    auto b = std::find_if (bs.begin (), bs.end (), [] (const bus &x) { return x.id == SENSORS_BUS_TYPE_VIRTUAL; });
+    if (b == bs.end ())
+    {
+        bs.push_back (bus { "Virtual device", SENSORS_BUS_TYPE_VIRTUAL, std::vector<chip> () });
+        b = bs.end () - 1;
+    }
+    for (auto &p : packages)
+    {
+        b->chips.push_back (chip ());
+        chip &c = b->chips.back ();
+        c.name = POWERCAP_CHIP;
+        for (auto &z : p.zones)
+        {
+            measurement m { POWER, -1, z.label };
+            uint64_t energy, time;
+            if (read_zone (z, energy, time))
+            {
+                // the counter wraps around at the end of its range
+                const uint64_t delta = energy >= z.energy ? energy - z.energy : z.range - z.energy + energy;
+                if (time > z.time)
+                    m.current = delta / 1e6 / ((time - z.time) / 1e9);
+                z.energy = energy;
+                z.time = time;
+            }
+            c.measurements.push_back (m);
+        }
+    }
+}
+
+} // namespace therm
@@ -0,0 +1,102 @@
+/// @file powercap.h
+/// @brief RAPL energy counters
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef POWERCAP_H
+#define POWERCAP_H
+
+#include "therm.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief default powercap sysfs directory
+const char *const POWERCAP_DIR = "/sys/class/powercap";
+
+/// @brief name of the chips that hold the RAPL readings
+const char *const POWERCAP_CHIP = "intel-rapl";
+
+/// @brief read the RAPL energy counters of the powercap interface
+///
+/// Each package becomes a chip on the virtual bus, with a power reading for
+/// the package and for each of its subzones, such as the cores and the DRAM.
+/// The power is the change in the energy counter since the previous scan
+/// divided by the time between them, allowing for the counter wrapping
+/// around.  Zones whose counters can't be read, which usually takes root,
+/// are left out.
+class powercap
+{
+    public:
+    /// @brief constructor
+    ///
+    /// @param dir powercap sysfs directory
+    powercap (const std::string &dir = POWERCAP_DIR);
+    /// @brief destructor
+    ~powercap ();
+    powercap (const powercap &) = delete;
+    powercap &operator= (const powercap &) = delete;
+    /// @brief check if there are any readable zones
+    ///
+    /// @return true if there are
+    bool empty () const { return packages.empty (); }
+    /// @brief add the power readings to a snapshot
+    ///
+    /// The chips are added to the virtual bus, which is added if there is
+    /// none.
+    ///
+    /// @param bs vector of bus sensor data
+    void scan (busses &bs);
+    private:
+    struct zone
+    {
+        std::string label;
+        int fd;
+        /// @brief the counter wraps around to 0 after this many uJ
+        uint64_t range;
+        /// @brief the previous reading, in uJ
+        uint64_t energy;
+        /// @brief time of the previous reading, in ns
+        uint64_t time;
+    };
+    struct package
+    {
+        std::vector<zone> zones;
+    };
+    /// @brief open a zone
+    ///
+    /// @param dir zone directory
+    /// @param zones opened zones
+    void open_zone (const std::string &dir, std::vector<zone> &zones);
+    /// @brief read a zone's energy counter
+    ///
+    /// @param z the zone
+    /// @param energy the counter in uJ
+    /// @param time the time of the reading in ns
+    ///
+    /// @return false if it could not be read
+    static bool read_zone (const zone &z, uint64_t &energy, uint64_t &time);
+    std::vector<package> packages;
+};
+
+} // namespace therm
+
+#endif
@@ -0,0 +1,127 @@
+/// @file remote.cc
+/// @brief read snapshots of a remote host from a collector
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "remote.h"
+#include "net.h"
+#include "shm.h"
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+
+namespace therm
+{
+
+/// @brief how long to wait for the first snapshot
+const int FIRST_SNAPSHOT_TIMEOUT = 5000;
+
+/// @brief how long to wait between connection attempts
+const uint64_t RECONNECT_INTERVAL = 1000;
+
+/// @brief how long to wait for the collector to accept a connection
+const int CONNECT_TIMEOUT = 1000;
+
+remote::remote (const std::string &addr, const std::string &host)
+    : addr (addr)
+    , host (host)
+    , fd (-1)
+    , retry (0)
+{
+    open ();
+}
+
+remote::~remote ()
+{
+    if (fd != -1)
+        close (fd);
+}
+
+std::string remote::get_description () const
+{
+    return host + " via " + addr;
+}
+
+void remote::open ()
+{
+    fd = connect_to (addr, CONNECT_TIMEOUT);
+    std::vector<char> buf;
+    encode_subscribe (host, buf);
+    if (!send_all (fd, &buf[0], buf.size ()))
+    {
+        drop ();
+        throw std::runtime_error ("could not subscribe to " + host + " at " + addr);
+    }
+    reader = frame_reader ();
+}
+
+void remote::drop ()
+{
+    close (fd);
+    fd = -1;
+    retry = now_ms () + RECONNECT_INTERVAL;
+}
+
+void remote::scan (busses &bs)
+{
+    if (fd == -1 && now_ms () >= retry)
+    {
+        try { open (); }
+        catch (const std::exception &) { retry = now_ms () + RECONNECT_INTERVAL; }
+    }
+    bool updated = false;
+    while (fd != -1)
+    {
+        // wait for the first snapshot, then take whatever has arrived
+        pollfd p { fd, POLLIN, 0 };
+        const int timeout = decoder.get_values ().empty () ? FIRST_SNAPSHOT_TIMEOUT : 0;
+        const int n = poll (&p, 1, timeout);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        if (reader.read (fd) <= 0)
+        {
+            drop ();
+            break;
+        }
+        try
+        {
+            while (const wire_header *h = reader.next ())
+                updated |= decoder.update (frame_view (h, h->size));
+        }
+        catch (const std::exception &)
+        {
+            drop ();
+        }
+    }
+    if (decoder.get_values ().empty ())
+    {
+        if (bs.empty ())
+            throw std::runtime_error ("no snapshots of " + host + " from " + addr);
+        return;
+    }
+    if (updated || bs.empty ())
+    {
+        const std::vector<char> &t = decoder.get_topology ();
+        const std::vector<char> &v = decoder.get_values ();
+        decode (frame_view (&t[0], t.size ()), frame_view (&v[0], v.size ()), bs);
+    }
+}
+
+} // namespace therm
@@ -0,0 +1,71 @@
+/// @file remote.h
+/// @brief read snapshots of a remote host from a collector
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef REMOTE_H
+#define REMOTE_H
+
+#include "wire.h"
+#include <cstdint>
+#include <string>
+
+namespace therm
+{
+
+/// @brief read the snapshots of a remote host from a collector
+class remote
+{
+    public:
+    /// @brief constructor
+    ///
+    /// @param addr collector address
+    /// @param host name of the host to view
+    remote (const std::string &addr, const std::string &host);
+    /// @brief destructor
+    ~remote ();
+    remote (const remote &) = delete;
+    remote &operator= (const remote &) = delete;
+    /// @brief describe where the snapshots come from
+    ///
+    /// @return the description
+    std::string get_description () const;
+    /// @brief get the latest snapshot
+    ///
+    /// The first call waits for a snapshot to arrive.  Later calls return
+    /// right away with the latest snapshot received.  If the connection is
+    /// lost the last snapshot is kept and the connection is retried.
+    ///
+    /// @param bs vector of bus sensor data
+    void scan (busses &bs);
+    private:
+    /// @brief connect and subscribe
+    void open ();
+    /// @brief drop the connection
+    void drop ();
+    std::string addr;
+    std::string host;
+    int fd;
+    uint64_t retry;
+    frame_reader reader;
+    wire_decoder decoder;
+};
+
+} // namespace therm
+
+#endif
@@ -0,0 +1,299 @@
+/// @file replay.cc
+/// @brief evaluate recorded snapshots
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "replay.h"
+#include "rules.h"
+#include "wire.h"
+#include <algorithm>
+#include <deque>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace therm
+{
+
+/// @brief follow one condition over the snapshots of a recording
+class interval_tracker
+{
+    public:
+    /// @brief constructor
+    ///
+    /// @param rule index of the rule, or -1 for the temperature limits
+    /// @param intervals where to put the intervals
+    interval_tracker (int rule, std::vector<alert_interval> &intervals)
+        : rule (rule)
+        , status (NORMAL)
+        , begin (0)
+        , last (0)
+        , intervals (intervals)
+    {
+    }
+    /// @brief add a snapshot
+    ///
+    /// @param s status of the condition
+    /// @param time time of the snapshot
+    /// @param gap true if the recording has a gap before it
+    void update (int s, uint64_t time, bool gap)
+    {
+        if (gap)
+            close (last);
+        else if (s != status)
+            close (time);
+        if (s != status)
+        {
+            status = s;
+            begin = time;
+        }
+        last = time;
+    }
+    /// @brief close the interval, if there is one
+    ///
+    /// @param time end of the interval
+    void close (uint64_t time)
+    {
+        if (status != NORMAL)
+            intervals.push_back (alert_interval { begin, time, status, rule });
+        status = NORMAL;
+    }
+    private:
+    int rule;
+    int status;
+    uint64_t begin;
+    uint64_t last;
+    std::vector<alert_interval> &intervals;
+};
+
+/// @brief evaluate the snapshots of a mapped recording
+///
+/// @param p the recording
+/// @param len its size
+/// @param rs compiled rules
+/// @param bus_id only check this bus, or all busses if ~0u
+/// @param s the summary
+static void replay (const char *p, size_t len, rule_set &rs, unsigned bus_id, replay_summary &s)
+{
+    wire_decoder d;
+    busses bs;
+    interval_tracker limits (-1, s.intervals);
+    std::vector<interval_tracker> rules;
+    for (size_t i = 0; i < rs.size (); ++i)
+        rules.push_back (interval_tracker (i, s.intervals));
+    int status = NORMAL;
+    for (size_t offset = 0; offset < len; )
+    {
+        const frame_view f (p + offset, len - offset);
+        // a recording that is still being written may end with part of a
+        // frame
+        if (!f.is_valid ())
+            break;
+        offset += f.size ();
+        if (!d.decode (f, bs))
+            continue;
+        const uint64_t time = d.get_time ();
+        if (s.snapshots++ == 0)
+        {
+            s.first = time;
+            s.host = d.get_host ();
+        }
+        // count the time since the previous snapshot at its status
+        const bool gap = s.snapshots > 1 && (time < s.last || time - s.last > REPLAY_MAX_GAP);
+        if (s.snapshots > 1 && !gap)
+        {
+            if (status >= HIGH)
+                s.high_time += time - s.last;
+            if (status == CRITICAL)
+                s.critical_time += time - s.last;
+        }
+        s.last = time;
+        status = NORMAL;
+        for (auto &b : bs)
+        {
+            // skip the bus if specified
+            if (bus_id != ~0u && bus_id != b.id)
+                continue;
+            for (auto &c : b.chips)
+                for (auto &t : c.temps)
+                {
+                    status = std::max (status, get_status (t));
+                    if (t.current > s.peak)
+                    {
+                        s.peak = t.current;
+                        s.peak_chip = c.name;
+                        s.peak_label = t.label;
+                        s.peak_time = time;
+                    }
+                }
+        }
+        limits.update (status, time, gap);
+        if (!rs.size ())
+            continue;
+        rs.evaluate (bs, time);
+        for (size_t i = 0; i < rs.size (); ++i)
+            rules[i].update (rs.is_active (i) ? HIGH : NORMAL, time, gap);
+    }
+    limits.close (s.last);
+    for (auto &r : rules)
+        r.close (s.last);
+    std::stable_sort (s.intervals.begin (), s.intervals.end (), [] (const alert_interval &a, const alert_interval &b)
+    {
+        return a.begin < b.begin;
+    });
+}
+
+replay_summary replay (const std::string &fn, const std::vector<std::string> &rules, unsigned bus_id)
+{
+    replay_summary s;
+    s.fn = fn;
+    s.snapshots = 0;
+    s.first = s.last = s.peak_time = 0;
+    s.peak = -1;
+    s.high_time = s.critical_time = 0;
+    rule_set rs;
+    for (auto &r : rules)
+        rs.add (r);
+    const int fd = open (fn.c_str (), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        s.error = "could not open " + fn;
+        return s;
+    }
+    struct stat st;
+    if (fstat (fd, &st) == -1)
+    {
+        close (fd);
+        s.error = "could not stat " + fn;
+        return s;
+    }
+    if (st.st_size == 0)
+    {
+        close (fd);
+        return s;
+    }
+    void *p = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (p == MAP_FAILED)
+    {
+        s.error = "could not map " + fn;
+        return s;
+    }
+    // frames are read once, in order
+    madvise (p, st.st_size, MADV_SEQUENTIAL);
+    replay (static_cast<const char *> (p), st.st_size, rs, bus_id, s);
+    munmap (p, st.st_size);
+    return s;
+}
+
+std::vector<replay_summary> replay (const std::vector<std::string> &fns, const std::vector<std::string> &rules, unsigned bus_id, unsigned threads)
+{
+    // deal out the largest recordings first
+    std::vector<std::pair<off_t, size_t>> sizes;
+    for (size_t i = 0; i < fns.size (); ++i)
+    {
+        struct stat st;
+        sizes.push_back (std::make_pair (stat (fns[i].c_str (), &st) == 0 ? st.st_size : 0, i));
+    }
+    std::sort (sizes.rbegin (), sizes.rend ());
+    std::vector<replay_summary> summaries (fns.size ());
+    run_tasks (fns.size (), threads, [&] (size_t k)
+    {
+        const size_t i = sizes[k].second;
+        try
+        {
+            summaries[i] = replay (fns[i], rules, bus_id);
+        }
+        catch (const std::exception &e)
+        {
+            summaries[i].fn = fns[i];
+            summaries[i].error = e.what ();
+        }
+    });
+    return summaries;
+}
+
+/// @brief a thread's tasks
+struct task_queue
+{
+    std::mutex m;
+    std::deque<size_t> tasks;
+};
+
+/// @brief take a task from a queue
+///
+/// @param q the queue
+/// @param front take it from the front, or else from the back
+/// @param task the task
+///
+/// @return false if the queue is empty
+static bool take (task_queue &q, bool front, size_t &task)
+{
+    std::lock_guard<std::mutex> lock (q.m);
+    if (q.tasks.empty ())
+        return false;
+    if (front)
+    {
+        task = q.tasks.front ();
+        q.tasks.pop_front ();
+    }
+    else
+    {
+        task = q.tasks.back ();
+        q.tasks.pop_back ();
+    }
+    return true;
+}
+
+void run_tasks (size_t tasks, unsigned threads, const std::function<void (size_t)> &f)
+{
+    threads = std::max (1u, std::min<unsigned> (threads, tasks));
+    std::vector<std::unique_ptr<task_queue>> queues;
+    for (unsigned i = 0; i < threads; ++i)
+        queues.push_back (std::unique_ptr<task_queue> (new task_queue));
+    for (size_t k = 0; k < tasks; ++k)
+        queues[k % threads]->tasks.push_back (k);
+    auto work = [&] (unsigned i)
+    {
+        size_t task;
+        for (;;)
+        {
+            bool found = take (*queues[i], true, task);
+            // no tasks are added, so once every queue is empty, we're done
+            for (unsigned j = 1; !found && j < threads; ++j)
+                found = take (*queues[(i + j) % threads], false, task);
+            if (!found)
+                return;
+            f (task);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i)
+        pool.push_back (std::thread (work, i));
+    work (0);
+    for (auto &t : pool)
+        t.join ();
+}
+
+} // namespace therm
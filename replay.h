@@ -0,0 +1,112 @@
+/// @file replay.h
+/// @brief evaluate recorded snapshots
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "therm.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief snapshots further apart than this, in ms, are a gap in the
+/// recording, and the time between them is not counted
+const uint64_t REPLAY_MAX_GAP = 60000;
+
+/// @brief a time during which a recording would have alerted
+struct alert_interval
+{
+    /// @brief times in ms since the epoch
+    uint64_t begin;
+    uint64_t end;
+    /// @brief HIGH or CRITICAL, for the temperature limits
+    int status;
+    /// @brief index of the rule, or -1 for the temperature limits
+    int rule;
+};
+
+/// @brief what a recording would have alerted about
+struct replay_summary
+{
+    /// @brief recording filename and host name
+    std::string fn;
+    std::string host;
+    /// @brief why the recording could not be read, or empty
+    std::string error;
+    size_t snapshots;
+    /// @brief times of the first and last snapshot in ms since the epoch
+    uint64_t first;
+    uint64_t last;
+    /// @brief the hottest temperature, where, and when
+    double peak;
+    std::string peak_chip;
+    std::string peak_label;
+    uint64_t peak_time;
+    /// @brief ms spent above the high and the critical limits
+    uint64_t high_time;
+    uint64_t critical_time;
+    /// @brief alert intervals in order of their beginning
+    std::vector<alert_interval> intervals;
+};
+
+/// @brief evaluate a recording
+///
+/// The recording is a stream of frames in the wire format, as written by
+/// thermcollect(1).  It is mapped and its frames are decoded in place.
+/// Each snapshot is checked against the temperature limits, as by check (),
+/// and against the rules, with the times of the recording, so rules with
+/// durations work.
+///
+/// @param fn recording filename
+/// @param rules rule expressions
+/// @param bus_id only check this bus, or all busses if ~0u
+///
+/// @return the summary
+replay_summary replay (const std::string &fn, const std::vector<std::string> &rules, unsigned bus_id = ~0u);
+
+/// @brief evaluate recordings in parallel
+///
+/// @param fns recording filenames
+/// @param rules rule expressions
+/// @param bus_id only check this bus, or all busses if ~0u
+/// @param threads number of threads
+///
+/// @return the summaries in the order of the filenames
+std::vector<replay_summary> replay (const std::vector<std::string> &fns, const std::vector<std::string> &rules, unsigned bus_id, unsigned threads);
+
+/// @brief run tasks on a work stealing pool
+///
+/// The tasks are dealt out to the threads in order, so give the largest
+/// first.  Each thread runs its own tasks from the front of its queue, and
+/// when it runs out, takes tasks from the back of the others' queues.
+///
+/// @param tasks number of tasks
+/// @param threads number of threads
+/// @param f called with the index of each task
+void run_tasks (size_t tasks, unsigned threads, const std::function<void (size_t)> &f);
+
+} // namespace therm
+
+#endif
@@ -0,0 +1,822 @@
+/// @file rules.cc
+/// @brief alert rules
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "rules.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+
+namespace therm
+{
+
+/// @brief stack machine operations
+enum opcode
+{
+    OP_PUSH,
+    OP_MAX,
+    OP_MIN,
+    OP_AVG,
+    OP_SUM,
+    OP_COUNT,
+    OP_OUTLIERS,
+    OP_DEVIATION,
+    OP_ANY,
+    OP_ANY_HIGH,
+    OP_ANY_CRITICAL,
+    OP_NEG,
+    OP_NOT,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_CMP,
+    OP_AND,
+    OP_OR
+};
+
+/// @brief comparison operators
+enum relop
+{
+    REL_GT,
+    REL_GE,
+    REL_LT,
+    REL_LE,
+    REL_EQ,
+    REL_NE
+};
+
+/// @brief compare two values
+///
+/// @param op comparison operator
+/// @param a left side
+/// @param b right side
+///
+/// @return the result
+static bool compare (int op, double a, double b)
+{
+    switch (op)
+    {
+        case REL_GT: return a > b;
+        case REL_GE: return a >= b;
+        case REL_LT: return a < b;
+        case REL_LE: return a <= b;
+        case REL_EQ: return a == b;
+        case REL_NE: return a != b;
+    }
+    return false;
+}
+
+/// @brief swap the sides of a comparison
+///
+/// @param op comparison operator
+///
+/// @return the operator with the sides swapped
+static int flip (int op)
+{
+    switch (op)
+    {
+        case REL_GT: return REL_LT;
+        case REL_GE: return REL_LE;
+        case REL_LT: return REL_GT;
+        case REL_LE: return REL_GE;
+    }
+    return op;
+}
+
+/// @brief match a glob, ignoring case
+///
+/// @param g the glob
+/// @param s the string
+///
+/// @return true if it matches
+static bool match (const char *g, const char *s)
+{
+    for (; *g; ++g, ++s)
+    {
+        if (*g == '*')
+        {
+            for (; *s; ++s)
+                if (match (g + 1, s))
+                    return true;
+            return match (g + 1, s);
+        }
+        if (!*s || (*g != '?' && tolower (*g) != tolower (*s)))
+            return false;
+    }
+    return !*s;
+}
+
+/// @brief a parsed expression
+struct node
+{
+    enum kind_type { NUMBER, SELECTOR, LIMIT, FUNCTION, UNARY, BINARY, COMPARISON };
+    kind_type kind;
+    int op;
+    double value;
+    std::string text;
+    std::unique_ptr<node> a, b;
+};
+
+/// @brief recursive descent parser for rule expressions
+class parser
+{
+    private:
+    const std::string &s;
+    size_t i;
+    /// @brief report a syntax error
+    ///
+    /// @param what what was expected
+    void fail (const std::string &what) const
+    {
+        throw std::runtime_error ("rule '" + s + "': expected " + what + " at position " + std::to_string (i + 1));
+    }
+    static bool is_word (char c)
+    {
+        return isalnum (static_cast<unsigned char> (c)) || c == '_' || c == '*' || c == '?'
+            || c == '-' || c == '.' || c == ':' || c == '[' || c == ']';
+    }
+    void skip ()
+    {
+        while (i < s.size () && isspace (static_cast<unsigned char> (s[i])))
+            ++i;
+    }
+    /// @brief consume a token if it is next
+    ///
+    /// @param t the token
+    ///
+    /// @return true if it was consumed
+    bool accept (const char *t)
+    {
+        skip ();
+        const size_t n = strlen (t);
+        if (s.compare (i, n, t) != 0)
+            return false;
+        // keywords must be whole words
+        if (isalpha (static_cast<unsigned char> (t[0])) && i + n < s.size () && is_word (s[i + n]))
+            return false;
+        i += n;
+        return true;
+    }
+    void expect (const char *t)
+    {
+        if (!accept (t))
+            fail (std::string ("'") + t + "'");
+    }
+    std::unique_ptr<node> make (node::kind_type kind, int op = 0)
+    {
+        std::unique_ptr<node> n (new node);
+        n->kind = kind;
+        n->op = op;
+        n->value = 0;
+        return n;
+    }
+    std::unique_ptr<node> binary (node::kind_type kind, int op, std::unique_ptr<node> a, std::unique_ptr<node> b)
+    {
+        std::unique_ptr<node> n = make (kind, op);
+        n->a = std::move (a);
+        n->b = std::move (b);
+        return n;
+    }
+    /// @brief read a number
+    ///
+    /// @return the number
+    double number ()
+    {
+        skip ();
+        const char *begin = s.c_str () + i;
+        char *end;
+        const double x = strtod (begin, &end);
+        if (end == begin)
+            fail ("a number");
+        i += end - begin;
+        return x;
+    }
+    /// @brief read a selector, which may be quoted
+    ///
+    /// @return the selector
+    std::string word ()
+    {
+        skip ();
+        if (i < s.size () && (s[i] == '"' || s[i] == '\''))
+        {
+            const size_t end = s.find (s[i], i + 1);
+            if (end == std::string::npos)
+                fail ("a closing quote");
+            const std::string w = s.substr (i + 1, end - i - 1);
+            i = end + 1;
+            return w;
+        }
+        const size_t begin = i;
+        while (i < s.size () && is_word (s[i]))
+            ++i;
+        if (i == begin)
+            fail ("a selector");
+        return s.substr (begin, i - begin);
+    }
+    std::unique_ptr<node> primary ()
+    {
+        skip ();
+        if (i == s.size ())
+            fail ("a value");
+        const char c = s[i];
+        if (isdigit (static_cast<unsigned char> (c)) || c == '.')
+        {
+            std::unique_ptr<node> n = make (node::NUMBER);
+            n->value = number ();
+            return n;
+        }
+        if (accept ("("))
+        {
+            std::unique_ptr<node> n = disjunction ();
+            expect (")");
+            return n;
+        }
+        const bool quoted = c == '"' || c == '\'';
+        const std::string w = word ();
+        if (!quoted)
+        {
+            static const char *functions[] = { "max", "min", "avg", "sum", "count", "outliers", "deviation" };
+            static const int ops[] = { OP_MAX, OP_MIN, OP_AVG, OP_SUM, OP_COUNT, OP_OUTLIERS, OP_DEVIATION };
+            for (size_t k = 0; k < 7; ++k)
+            {
+                if (w != functions[k] || !accept ("("))
+                    continue;
+                std::unique_ptr<node> n = make (node::FUNCTION, ops[k]);
+                n->text = word ();
+                expect (")");
+                return n;
+            }
+            if (w == "high" || w == "critical")
+                return make (node::LIMIT, w == "high" ? OP_ANY_HIGH : OP_ANY_CRITICAL);
+            if (w == "and" || w == "or" || w == "not" || w == "for")
+            {
+                i -= w.size ();
+                fail ("a value");
+            }
+        }
+        std::unique_ptr<node> n = make (node::SELECTOR);
+        n->text = w;
+        return n;
+    }
+    std::unique_ptr<node> unary ()
+    {
+        if (accept ("-"))
+        {
+            std::unique_ptr<node> n = make (node::UNARY, OP_NEG);
+            n->a = unary ();
+            return n;
+        }
+        return primary ();
+    }
+    std::unique_ptr<node> product ()
+    {
+        std::unique_ptr<node> n = unary ();
+        for (;;)
+        {
+            if (accept ("*"))
+                n = binary (node::BINARY, OP_MUL, std::move (n), unary ());
+            else if (accept ("/"))
+                n = binary (node::BINARY, OP_DIV, std::move (n), unary ());
+            else
+                return n;
+        }
+    }
+    std::unique_ptr<node> sum ()
+    {
+        std::unique_ptr<node> n = product ();
+        for (;;)
+        {
+            if (accept ("+"))
+                n = binary (node::BINARY, OP_ADD, std::move (n), product ());
+            else if (accept ("-"))
+                n = binary (node::BINARY, OP_SUB, std::move (n), product ());
+            else
+                return n;
+        }
+    }
+    std::unique_ptr<node> comparison ()
+    {
+        std::unique_ptr<node> n = sum ();
+        static const char *tokens[] = { ">=", "<=", "==", "!=", ">", "<" };
+        static const int ops[] = { REL_GE, REL_LE, REL_EQ, REL_NE, REL_GT, REL_LT };
+        for (size_t k = 0; k < 6; ++k)
+            if (accept (tokens[k]))
+                return binary (node::COMPARISON, ops[k], std::move (n), sum ());
+        return n;
+    }
+    std::unique_ptr<node> negation ()
+    {
+        if (accept ("not"))
+        {
+            std::unique_ptr<node> n = make (node::UNARY, OP_NOT);
+            n->a = negation ();
+            return n;
+        }
+        return comparison ();
+    }
+    std::unique_ptr<node> conjunction ()
+    {
+        std::unique_ptr<node> n = negation ();
+        while (accept ("and"))
+            n = binary (node::BINARY, OP_AND, std::move (n), negation ());
+        return n;
+    }
+    std::unique_ptr<node> disjunction ()
+    {
+        std::unique_ptr<node> n = conjunction ();
+        while (accept ("or"))
+            n = binary (node::BINARY, OP_OR, std::move (n), conjunction ());
+        return n;
+    }
+    public:
+    parser (const std::string &s)
+        : s (s)
+        , i (0)
+    {
+    }
+    /// @brief parse a rule
+    ///
+    /// @param duration how long the rule must hold, in ms
+    ///
+    /// @return the expression
+    std::unique_ptr<node> parse (uint64_t &duration)
+    {
+        std::unique_ptr<node> n = disjunction ();
+        duration = 0;
+        if (accept ("for"))
+        {
+            const double x = number ();
+            double scale = 1000;
+            if (accept ("ms"))
+                scale = 1;
+            else if (accept ("s"))
+                scale = 1000;
+            else if (accept ("m"))
+                scale = 60 * 1000;
+            else if (accept ("h"))
+                scale = 60 * 60 * 1000;
+            if (x < 0)
+                fail ("a positive duration");
+            duration = x * scale;
+        }
+        skip ();
+        if (i != s.size ())
+            fail ("the end of the rule");
+        return n;
+    }
+};
+
+/// @brief generate code for an expression
+class emitter
+{
+    private:
+    const std::string &expression;
+    std::vector<rule_set::instruction> &code;
+    std::vector<rule_set::selector> &selectors;
+    size_t depth;
+    size_t max_depth;
+    void fail (const std::string &why) const
+    {
+        throw std::runtime_error ("rule '" + expression + "': " + why);
+    }
+    /// @brief get the index of a selector, adding it if it is new
+    ///
+    /// @param text the selector
+    ///
+    /// @return the index
+    uint32_t get_selector (const std::string &text)
+    {
+        rule_set::selector sel;
+        const size_t colon = text.find (':');
+        if (colon != std::string::npos)
+        {
+            sel.chip = text.substr (0, colon);
+            sel.sensor = text.substr (colon + 1);
+            if (sel.chip.empty () || sel.sensor.empty ())
+                fail ("'" + text + "' needs a chip and a sensor");
+        }
+        else
+            sel.sensor = text;
+        // labels like 'Package id 0' are matched by their first words
+        sel.label = sel.sensor + "*";
+        for (size_t k = 0; k < selectors.size (); ++k)
+            if (selectors[k].chip == sel.chip && selectors[k].sensor == sel.sensor)
+                return k;
+        sel.min = sel.max = sel.sum = sel.count = sel.outliers = sel.deviation = 0;
+        selectors.push_back (sel);
+        return selectors.size () - 1;
+    }
+    void emit (int op, int rel = 0, uint32_t selector = 0, double value = 0)
+    {
+        rule_set::instruction ins;
+        ins.op = op;
+        ins.relop = rel;
+        ins.selector = selector;
+        ins.value = value;
+        code.push_back (ins);
+        // operations either push one value, pop one, or leave the depth
+        switch (op)
+        {
+            case OP_PUSH: case OP_MAX: case OP_MIN: case OP_AVG: case OP_SUM: case OP_COUNT:
+            case OP_OUTLIERS: case OP_DEVIATION: case OP_ANY_HIGH: case OP_ANY_CRITICAL:
+            max_depth = std::max (max_depth, ++depth);
+            break;
+            case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_CMP: case OP_AND: case OP_OR:
+            --depth;
+            break;
+        }
+    }
+    public:
+    emitter (const std::string &expression, std::vector<rule_set::instruction> &code, std::vector<rule_set::selector> &selectors)
+        : expression (expression)
+        , code (code)
+        , selectors (selectors)
+        , depth (0)
+        , max_depth (0)
+    {
+    }
+    /// @brief get the deepest the stack gets
+    ///
+    /// @return the depth
+    size_t get_max_depth () const { return max_depth; }
+    /// @brief generate code that leaves the value of an expression on the
+    /// stack
+    ///
+    /// @param n the expression
+    void generate (const node &n)
+    {
+        switch (n.kind)
+        {
+            case node::NUMBER:
+            emit (OP_PUSH, 0, 0, n.value);
+            break;
+            case node::SELECTOR:
+            fail ("'" + n.text + "' must be compared with a value or used in a function");
+            break;
+            case node::LIMIT:
+            fail ("'high' and 'critical' can only be compared with a selector");
+            break;
+            case node::FUNCTION:
+            emit (n.op, 0, get_selector (n.text));
+            break;
+            case node::UNARY:
+            generate (*n.a);
+            emit (n.op);
+            break;
+            case node::BINARY:
+            generate (*n.a);
+            generate (*n.b);
+            emit (n.op);
+            break;
+            case node::COMPARISON:
+            {
+                const node *sel = nullptr;
+                const node *other = nullptr;
+                int rel = n.op;
+                if (n.a->kind == node::SELECTOR)
+                {
+                    sel = n.a.get ();
+                    other = n.b.get ();
+                }
+                else if (n.b->kind == node::SELECTOR)
+                {
+                    sel = n.b.get ();
+                    other = n.a.get ();
+                    rel = flip (rel);
+                }
+                if (sel == nullptr)
+                {
+                    generate (*n.a);
+                    generate (*n.b);
+                    emit (OP_CMP, rel);
+                }
+                else if (other->kind == node::SELECTOR)
+                    fail ("can't compare two selectors, use a function on one of them");
+                else if (other->kind == node::LIMIT)
+                    emit (other->op, rel, get_selector (sel->text));
+                else
+                {
+                    generate (*other);
+                    emit (OP_ANY, rel, get_selector (sel->text));
+                }
+            }
+            break;
+        }
+    }
+};
+
+std::vector<rule> read_rules (const std::string &fn)
+{
+    std::ifstream ifs (fn.c_str ());
+    if (!ifs)
+        throw std::runtime_error ("could not open rules file " + fn);
+    std::vector<rule> rules;
+    std::string line;
+    for (size_t n = 1; getline (ifs, line); ++n)
+    {
+        const size_t first = line.find_first_not_of (" \t");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+        const size_t arrow = line.find ("=>");
+        if (arrow == std::string::npos)
+            throw std::runtime_error (fn + ":" + std::to_string (n) + ": expected 'expression => command'");
+        rule r;
+        r.expression = line.substr (first, arrow - first);
+        r.expression.erase (r.expression.find_last_not_of (" \t") + 1);
+        const size_t cmd = line.find_first_not_of (" \t", arrow + 2);
+        if (cmd != std::string::npos)
+            r.command = line.substr (cmd);
+        rules.push_back (r);
+    }
+    return rules;
+}
+
+rule_set::rule_set ()
+    : uses_peers (false)
+{
+}
+
+size_t rule_set::add (const std::string &expression)
+{
+    uint64_t duration;
+    std::unique_ptr<node> n = parser (expression).parse (duration);
+    compiled_rule r;
+    r.expression = expression;
+    r.first = code.size ();
+    r.duration = duration;
+    r.since = 0;
+    r.active = r.changed = false;
+    const size_t nselectors = selectors.size ();
+    emitter e (expression, code, selectors);
+    try
+    {
+        e.generate (*n);
+    }
+    catch (...)
+    {
+        code.resize (r.first);
+        selectors.resize (nselectors);
+        throw;
+    }
+    r.size = code.size () - r.first;
+    for (size_t pc = r.first; pc < code.size (); ++pc)
+        uses_peers = uses_peers || code[pc].op == OP_OUTLIERS || code[pc].op == OP_DEVIATION;
+    stack.resize (std::max (stack.size (), e.get_max_depth ()));
+    rules.push_back (r);
+    // resolve the new selectors with the next snapshot
+    names.clear ();
+    return rules.size () - 1;
+}
+
+void rule_set::update_topology (const busses &bs)
+{
+    // chip name, label and kind of every sensor in snapshot order
+    size_t n = 0;
+    bool same = true;
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+        {
+            for (auto &t : c.temps)
+            {
+                same = same && n + 3 <= names.size () && names[n] == c.name && names[n + 1] == t.label && names[n + 2] == "temp";
+                n += 3;
+            }
+            for (auto &f : c.fan_speeds)
+            {
+                same = same && n + 3 <= names.size () && names[n] == c.name && names[n + 1] == f.label && names[n + 2] == "fan";
+                n += 3;
+            }
+            for (auto &m : c.measurements)
+            {
+                same = same && n + 3 <= names.size () && names[n] == c.name && names[n + 1] == m.label && names[n + 2] == get_kind_name (m.kind);
+                n += 3;
+            }
+        }
+    if (same && n == names.size ())
+        return;
+    names.clear ();
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+        {
+            for (auto &t : c.temps)
+            {
+                names.push_back (c.name);
+                names.push_back (t.label);
+                names.push_back ("temp");
+            }
+            for (auto &f : c.fan_speeds)
+            {
+                names.push_back (c.name);
+                names.push_back (f.label);
+                names.push_back ("fan");
+            }
+            for (auto &m : c.measurements)
+            {
+                names.push_back (c.name);
+                names.push_back (m.label);
+                names.push_back (get_kind_name (m.kind));
+            }
+        }
+    for (auto &sel : selectors)
+    {
+        sel.indices.clear ();
+        for (size_t k = 0; k < names.size (); k += 3)
+        {
+            const bool kind = match (sel.sensor.c_str (), names[k + 2].c_str ());
+            const bool sensor = kind || match (sel.label.c_str (), names[k + 1].c_str ());
+            bool matches = sel.chip.empty ()
+                ? sensor || match (sel.sensor.c_str (), names[k].c_str ())
+                : sensor && match (sel.chip.c_str (), names[k].c_str ());
+            // frequencies and throttle events have the labels of the
+            // temperatures they go with, so only selectors of their kind
+            // pick them
+            if (names[k + 2] == get_kind_name (FREQUENCY) || names[k + 2] == get_kind_name (THROTTLE))
+                matches = kind && (sel.chip.empty () || match (sel.chip.c_str (), names[k].c_str ()));
+            if (matches)
+                sel.indices.push_back (k / 3);
+        }
+    }
+}
+
+std::vector<uint32_t> rule_set::get_sensors (const busses &bs)
+{
+    update_topology (bs);
+    std::vector<uint32_t> indices;
+    for (auto &sel : selectors)
+        indices.insert (indices.end (), sel.indices.begin (), sel.indices.end ());
+    std::sort (indices.begin (), indices.end ());
+    indices.erase (std::unique (indices.begin (), indices.end ()), indices.end ());
+    return indices;
+}
+
+void rule_set::evaluate (const busses &bs, uint64_t time)
+{
+    update_topology (bs);
+    // flatten the snapshot
+    values.clear ();
+    highs.clear ();
+    criticals.clear ();
+    deviations.clear ();
+    outliers.clear ();
+    if (uses_peers)
+        peers.update (bs);
+    const double nan = std::numeric_limits<double>::quiet_NaN ();
+    size_t n = 0;
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+        {
+            for (auto &t : c.temps)
+            {
+                values.push_back (t.current);
+                highs.push_back (t.high);
+                criticals.push_back (t.critical);
+                if (uses_peers)
+                {
+                    deviations.push_back (peers.get_deviations ()[n]);
+                    outliers.push_back (peers.get_outliers ()[n]);
+                }
+                ++n;
+            }
+            for (auto &f : c.fan_speeds)
+            {
+                values.push_back (f.current);
+                highs.push_back (-1);
+                criticals.push_back (-1);
+                if (uses_peers)
+                {
+                    deviations.push_back (nan);
+                    outliers.push_back (0);
+                }
+            }
+            for (auto &m : c.measurements)
+            {
+                values.push_back (m.current);
+                highs.push_back (-1);
+                criticals.push_back (-1);
+                if (uses_peers)
+                {
+                    deviations.push_back (nan);
+                    outliers.push_back (0);
+                }
+            }
+        }
+    // reduce each selector once
+    for (auto &sel : selectors)
+    {
+        sel.min = std::numeric_limits<double>::infinity ();
+        sel.max = -sel.min;
+        sel.sum = sel.count = 0;
+        for (auto k : sel.indices)
+        {
+            const double x = values[k];
+            if (!std::isfinite (x))
+                continue;
+            sel.min = std::min (sel.min, x);
+            sel.max = std::max (sel.max, x);
+            sel.sum += x;
+            ++sel.count;
+        }
+        if (sel.count == 0)
+            sel.min = sel.max = nan;
+        if (!uses_peers)
+            continue;
+        // only temperatures have a deviation
+        sel.outliers = 0;
+        sel.deviation = -std::numeric_limits<double>::infinity ();
+        for (auto k : sel.indices)
+        {
+            if (!std::isfinite (deviations[k]))
+                continue;
+            sel.outliers += outliers[k];
+            sel.deviation = std::max (sel.deviation, deviations[k]);
+        }
+        if (!std::isfinite (sel.deviation))
+            sel.deviation = nan;
+    }
+    // run the program
+    for (auto &r : rules)
+    {
+        double *sp = stack.empty () ? nullptr : &stack[0];
+        for (size_t pc = r.first; pc < r.first + r.size; ++pc)
+        {
+            const instruction &ins = code[pc];
+            switch (ins.op)
+            {
+                case OP_PUSH: *sp++ = ins.value; break;
+                case OP_MAX: *sp++ = selectors[ins.selector].max; break;
+                case OP_MIN: *sp++ = selectors[ins.selector].min; break;
+                case OP_AVG:
+                {
+                    const selector &sel = selectors[ins.selector];
+                    *sp++ = sel.count ? sel.sum / sel.count : nan;
+                }
+                break;
+                case OP_SUM: *sp++ = selectors[ins.selector].sum; break;
+                case OP_COUNT: *sp++ = selectors[ins.selector].count; break;
+                case OP_OUTLIERS: *sp++ = selectors[ins.selector].outliers; break;
+                case OP_DEVIATION: *sp++ = selectors[ins.selector].deviation; break;
+                case OP_ANY:
+                {
+                    const double x = sp[-1];
+                    bool any = false;
+                    for (auto k : selectors[ins.selector].indices)
+                        any = any || compare (ins.relop, values[k], x);
+                    sp[-1] = any;
+                }
+                break;
+                case OP_ANY_HIGH:
+                case OP_ANY_CRITICAL:
+                {
+                    const std::vector<double> &limits = ins.op == OP_ANY_HIGH ? highs : criticals;
+                    bool any = false;
+                    for (auto k : selectors[ins.selector].indices)
+                        any = any || (limits[k] > 0 && compare (ins.relop, values[k], limits[k]));
+                    *sp++ = any;
+                }
+                break;
+                case OP_NEG: sp[-1] = -sp[-1]; break;
+                case OP_NOT: sp[-1] = sp[-1] == 0; break;
+                case OP_ADD: --sp; sp[-1] += sp[0]; break;
+                case OP_SUB: --sp; sp[-1] -= sp[0]; break;
+                case OP_MUL: --sp; sp[-1] *= sp[0]; break;
+                case OP_DIV: --sp; sp[-1] /= sp[0]; break;
+                case OP_CMP: --sp; sp[-1] = compare (ins.relop, sp[-1], sp[0]); break;
+                case OP_AND: --sp; sp[-1] = sp[-1] != 0 && sp[0] != 0; break;
+                case OP_OR: --sp; sp[-1] = sp[-1] != 0 || sp[0] != 0; break;
+            }
+        }
+        // a nan result, from an empty selector, is false
+        const bool holds = r.size != 0 && stack[0] != 0 && !std::isnan (stack[0]);
+        if (!holds)
+            r.since = 0;
+        else if (r.since == 0)
+            r.since = time;
+        const bool active = holds && time - r.since >= r.duration;
+        r.changed = active != r.active;
+        r.active = active;
+    }
+}
+
+} // namespace therm
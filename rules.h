@@ -0,0 +1,183 @@
+/// @file rules.h
+/// @brief alert rules
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef RULES_H
+#define RULES_H
+
+#include "peers.h"
+#include "therm.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief an alert rule and the command to run when it becomes active
+struct rule
+{
+    std::string expression;
+    std::string command;
+};
+
+/// @brief read rules from a file
+///
+/// Each line holds an expression and a command separated by '=>'.  Blank
+/// lines and lines starting with '#' are ignored.
+///
+/// @param fn filename
+///
+/// @return the rules
+std::vector<rule> read_rules (const std::string &fn);
+
+/// @brief compiled alert rules
+///
+/// Expressions look like
+///
+///     max(coretemp*) > 90 for 30s
+///     avg('package id') - avg(ambient) > 40
+///     sum(intel-rapl:package*) > 150
+///     throttle > 0
+///     fan == 0 and temp > 60
+///     temp > high
+///     outliers(core) > 0 for 1m
+///     deviation(coretemp) > 15
+///
+/// A selector is a glob that picks the sensors whose chip name or kind
+/// ('temp', 'fan', 'power', 'voltage', 'current', 'energy', 'frequency' or
+/// 'throttle') it matches, or whose label starts with it, ignoring
+/// case.  Frequencies and throttle counts are only picked by their kind.
+/// Selectors may be quoted, and may be written 'chip:sensor' to match
+/// the chip and the sensor separately.  Functions max, min, avg, sum and count
+/// reduce a selector to a number.  Function outliers counts the temperatures
+/// of a selector that stand out from their peers, and deviation is the
+/// furthest any of them is above the median of its peers, as found by
+/// peer_analysis.  A selector compared with a value is true
+/// if any of its sensors compares true, and may be compared with its own
+/// 'high' or 'critical' limit.  Arithmetic, comparisons, 'and', 'or', 'not'
+/// and parentheses work as usual.  A rule with 'for' must hold for that long,
+/// in ms, s, m or h, before it becomes active.
+///
+/// Rules are compiled into one flat program for a stack machine.  Selectors
+/// are resolved to sensor indices only when the topology changes, and the
+/// reductions of each distinct selector are computed once per snapshot, so
+/// evaluation is linear in the number of sensors and rules.
+class rule_set
+{
+    public:
+    /// @brief constructor
+    rule_set ();
+    /// @brief compile and add a rule
+    ///
+    /// @param expression the rule
+    ///
+    /// @return the rule's index
+    size_t add (const std::string &expression);
+    /// @brief get the number of rules
+    ///
+    /// @return the number of rules
+    size_t size () const { return rules.size (); }
+    /// @brief get a rule's expression
+    ///
+    /// @param i rule index
+    ///
+    /// @return the expression
+    const std::string &get_expression (size_t i) const { return rules[i].expression; }
+    /// @brief evaluate the rules against a snapshot
+    ///
+    /// @param bs vector of bus sensor data
+    /// @param time sample time in ms since the epoch
+    void evaluate (const busses &bs, uint64_t time);
+    /// @brief check if a rule is active
+    ///
+    /// @param i rule index
+    ///
+    /// @return true if the rule has held for its duration
+    bool is_active (size_t i) const { return rules[i].active; }
+    /// @brief check if a rule became active or inactive in the last
+    /// evaluation
+    ///
+    /// @param i rule index
+    ///
+    /// @return true if it did
+    bool is_changed (size_t i) const { return rules[i].changed; }
+    /// @brief get the sensors that the rules refer to
+    ///
+    /// @param bs vector of bus sensor data
+    ///
+    /// @return sorted indices of the sensors in snapshot order
+    std::vector<uint32_t> get_sensors (const busses &bs);
+    /// @brief the stack machine's instructions
+    struct instruction
+    {
+        uint16_t op;
+        uint16_t relop;
+        uint32_t selector;
+        double value;
+    };
+    /// @brief a set of sensors
+    struct selector
+    {
+        /// @brief globs for the chip name, and the sensor kind or label
+        std::string chip;
+        std::string sensor;
+        std::string label;
+        /// @brief indices of the matching sensors in the current topology
+        std::vector<uint32_t> indices;
+        /// @brief reductions over the current snapshot
+        double min, max, sum, count;
+        /// @brief how many of the sensors stand out from their peers, and
+        /// the furthest any is above the median of its peers
+        double outliers, deviation;
+    };
+    private:
+    /// @brief resolve the selectors if the topology changed
+    ///
+    /// @param bs vector of bus sensor data
+    void update_topology (const busses &bs);
+    struct compiled_rule
+    {
+        std::string expression;
+        uint32_t first;
+        uint32_t size;
+        uint64_t duration;
+        uint64_t since;
+        bool active;
+        bool changed;
+    };
+    std::vector<compiled_rule> rules;
+    std::vector<instruction> code;
+    std::vector<selector> selectors;
+    /// @brief chip names and labels of the current topology
+    std::vector<std::string> names;
+    /// @brief values and limits in snapshot order
+    std::vector<double> values, highs, criticals;
+    /// @brief peer deviations and outliers in snapshot order, only if a
+    /// rule uses them
+    bool uses_peers;
+    peer_analysis peers;
+    std::vector<double> deviations;
+    std::vector<uint8_t> outliers;
+    std::vector<double> stack;
+};
+
+} // namespace therm
+
+#endif
@@ -0,0 +1,75 @@
+/// @file sampler.cc
+/// @brief sensor sampling API
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "sampler.h"
+#include "source.h"
+#include <vector>
+
+namespace therm
+{
+
+/// @brief sampler implementation
+struct sampler::impl
+{
+    impl (const std::string &shm_name, const std::string &cache_fn)
+        : s (shm_name, cache_fn)
+    {
+    }
+    source s;
+    event_engine events;
+};
+
+sampler::sampler ()
+    : p (new impl (SHM_NAME, std::string ()))
+{
+}
+
+sampler::sampler (const std::string &shm_name, const std::string &cache_fn)
+    : p (new impl (shm_name, cache_fn))
+{
+}
+
+sampler::~sampler ()
+{
+}
+
+std::string sampler::get_description () const
+{
+    return p->s.get_description ();
+}
+
+void sampler::read_history (std::vector<shm_sample> &h) const
+{
+    p->s.read_history (h);
+}
+
+void sampler::scan (busses &bs)
+{
+    p->s.scan (bs);
+    if (p->events.is_active ())
+        p->events.update (bs);
+}
+
+event_engine &sampler::get_events ()
+{
+    return p->events;
+}
+
+} // namespace therm
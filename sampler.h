@@ -0,0 +1,87 @@
+/// @file sampler.h
+/// @brief sensor sampling API
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "events.h"
+#include "shm.h"
+#include "therm.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief sample the sensors
+///
+/// This is the entry point for programs that embed therm.  Its layout does
+/// not depend on how the snapshots are obtained, so it stays the same as the
+/// rest of the library changes.
+///
+/// A sampler reads from the thermd(1) shared memory segment when thermd is
+/// running, and from the sensors otherwise.
+class sampler
+{
+    public:
+    /// @brief open the default shared memory segment, without a topology cache
+    sampler ();
+    /// @brief open
+    ///
+    /// @param shm_name shared memory segment name, empty to never use shared memory
+    /// @param cache_fn topology cache filename, empty to never use the cache
+    sampler (const std::string &shm_name, const std::string &cache_fn);
+    /// @brief destructor
+    ~sampler ();
+    sampler (const sampler &) = delete;
+    sampler &operator= (const sampler &) = delete;
+    /// @brief get a description of where the snapshots come from
+    ///
+    /// @return the description
+    std::string get_description () const;
+    /// @brief get the history published by thermd(1)
+    ///
+    /// Sample values are in the same order as the sensors in a snapshot.
+    ///
+    /// @param h history, oldest sample first, empty if thermd isn't running
+    void read_history (std::vector<shm_sample> &h) const;
+    /// @brief scan the busses into a caller owned snapshot
+    ///
+    /// The snapshot's storage is reused.  The event engine's subscribers are
+    /// notified after the snapshot has been filled.
+    ///
+    /// @param bs vector of bus sensor data
+    void scan (busses &bs);
+    /// @brief get the per-sensor event engine
+    ///
+    /// The engine runs after each scan once it has subscribers or a file
+    /// descriptor.
+    ///
+    /// @return the engine
+    event_engine &get_events ();
+    private:
+    struct impl;
+    std::unique_ptr<impl> p;
+};
+
+} // namespace therm
+
+#endif
@@ -0,0 +1,102 @@
+/// @file scan.cc
+/// @brief scan the sensors
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "therm.h"
+#include <algorithm>
+
+namespace therm
+{
+
+busses scan (const sensors &s)
+{
+    busses bs;
+    scan (s, bs);
+    return bs;
+}
+
+void scan (const sensors &s, busses &bs)
+{
+    size_t nbusses = 0;
+    chip_features f;
+    for (short i = 0; i < MAX_BUSSES; ++i)
+    {
+        // get chips on this bus
+        auto chips = s.get_chips (i);
+        if (chips.empty ())
+            continue;
+        if (bs.size () == nbusses)
+            bs.push_back (bus ());
+        bus &b = bs[nbusses++];
+        // get bus name
+        sensors_bus_id id { i, 0 };
+        const char *name = sensors_get_adapter_name (&id);
+        if (name == nullptr)
+            b.name = "Unknown";
+        else
+            b.name = name;
+        b.id = i;
+        b.chips.resize (chips.size ());
+        for (size_t j = 0; j < chips.size (); ++j)
+        {
+            chip &ch = b.chips[j];
+            ch.name = chips[j]->prefix;
+            s.get_features (chips[j], f);
+            const auto &temps = f.temps;
+            ch.temps.resize (temps.size ());
+            for (size_t k = 0; k < temps.size (); ++k)
+                ch.temps[k] = temperature { temps[k].current, temps[k].high, temps[k].critical, temps[k].label };
+            const auto &fss = f.fan_speeds;
+            ch.fan_speeds.resize (fss.size ());
+            for (size_t k = 0; k < fss.size (); ++k)
+                ch.fan_speeds[k] = fan_speed { fss[k].current, fss[k].label };
+            const auto &ms = f.measurements;
+            ch.measurements.resize (ms.size ());
+            for (size_t k = 0; k < ms.size (); ++k)
+                ch.measurements[k] = measurement { ms[k].kind, ms[k].current, ms[k].label };
+        }
+    }
+    bs.resize (nbusses);
+}
+
+int get_status (const temperature &t)
+{
+    if (t.critical > 0 && t.current > t.critical)
+        return CRITICAL;
+    else if (t.high > 0 && t.current > t.high)
+        return HIGH;
+    return NORMAL;
+}
+
+int check (const busses &bs, unsigned bus_id)
+{
+    int status = NORMAL;
+    for (auto &b : bs)
+    {
+        // skip the bus if specified
+        if (bus_id != ~0u && bus_id != b.id)
+            continue;
+        for (auto &c : b.chips)
+            for (auto &t : c.temps)
+                status = std::max (status, get_status (t));
+    }
+    return status;
+}
+
+} // namespace therm
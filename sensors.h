@@ -21,6 +21,7 @@
 #ifndef SENSORS_H
 #define SENSORS_H
 
+#include <cstdlib>
 #include <iostream>
 #include <sensors/sensors.h>
 #include <stdexcept>
@@ -39,14 +40,185 @@ struct temperature_feature
     double current;
     double high;
     double critical;
+    std::string label;
 };
 
 /// @brief fan speed reading
 struct fan_speed_feature
 {
     double current;
+    std::string label;
 };
 
+/// @brief kinds of electrical and processor readings
+enum measurement_kind
+{
+    POWER,
+    VOLTAGE,
+    CURRENT,
+    ENERGY,
+    FREQUENCY,
+    THROTTLE,
+    MEASUREMENT_KINDS
+};
+
+/// @brief power, voltage, current or energy reading
+struct measurement_feature
+{
+    int kind;
+    double current;
+    std::string label;
+};
+
+/// @brief sysfs attributes of a temperature reading, empty if not present
+struct temperature_attributes
+{
+    std::string current;
+    std::string high;
+    std::string critical;
+    /// @brief the label itself, since it may come from the configuration
+    std::string label;
+};
+
+/// @brief sysfs attributes of a fan speed reading, empty if not present
+struct fan_speed_attributes
+{
+    std::string current;
+    /// @brief the label itself, since it may come from the configuration
+    std::string label;
+};
+
+/// @brief sysfs attributes of a power, voltage, current or energy reading
+struct measurement_attributes
+{
+    int kind;
+    std::string current;
+    /// @brief sysfs units per value unit
+    double scale;
+    /// @brief the label itself, since it may come from the configuration
+    std::string label;
+};
+
+/// @brief all the readings on a chip
+struct chip_features
+{
+    std::vector<temperature_feature> temps;
+    std::vector<fan_speed_feature> fan_speeds;
+    std::vector<measurement_feature> measurements;
+};
+
+/// @brief the sysfs attributes of all the readings on a chip
+struct chip_attributes
+{
+    std::vector<temperature_attributes> temps;
+    std::vector<fan_speed_attributes> fan_speeds;
+    std::vector<measurement_attributes> measurements;
+};
+
+/// @brief the subfeature values of any feature, -1 if not present
+struct feature_values
+{
+    double current;
+    double high;
+    double critical;
+    std::string label;
+};
+
+/// @brief the subfeature attributes of any feature, empty if not present
+struct feature_attributes
+{
+    std::string current;
+    std::string high;
+    std::string critical;
+    std::string label;
+};
+
+/// @brief the subfeatures that are read from a kind of feature, and where
+/// its readings go
+///
+/// Each specialization names the subfeature types that hold the current
+/// value, a fallback for the current value, and the high and critical
+/// limits, SENSORS_SUBFEATURE_UNKNOWN for the ones it doesn't have, and
+/// stores the values or attributes in the chip's collection for its kind.
+///
+/// @tparam T sensors_feature_type
+template<int T>
+struct feature_type;
+
+template<>
+struct feature_type<SENSORS_FEATURE_TEMP>
+{
+    static const int input = SENSORS_SUBFEATURE_TEMP_INPUT;
+    static const int fallback = SENSORS_SUBFEATURE_UNKNOWN;
+    static const int high = SENSORS_SUBFEATURE_TEMP_MAX;
+    static const int critical = SENSORS_SUBFEATURE_TEMP_CRIT;
+    static void store (const feature_values &v, chip_features &f)
+    {
+        f.temps.push_back (temperature_feature { v.current, v.high, v.critical, v.label });
+    }
+    static void store (const feature_attributes &a, chip_attributes &f)
+    {
+        f.temps.push_back (temperature_attributes { a.current, a.high, a.critical, a.label });
+    }
+};
+
+template<>
+struct feature_type<SENSORS_FEATURE_FAN>
+{
+    static const int input = SENSORS_SUBFEATURE_FAN_INPUT;
+    static const int fallback = SENSORS_SUBFEATURE_UNKNOWN;
+    static const int high = SENSORS_SUBFEATURE_UNKNOWN;
+    static const int critical = SENSORS_SUBFEATURE_UNKNOWN;
+    static void store (const feature_values &v, chip_features &f)
+    {
+        f.fan_speeds.push_back (fan_speed_feature { v.current, v.label });
+    }
+    static void store (const feature_attributes &a, chip_attributes &f)
+    {
+        f.fan_speeds.push_back (fan_speed_attributes { a.current, a.label });
+    }
+};
+
+/// @brief an electrical reading
+///
+/// @tparam K measurement_kind
+/// @tparam I input subfeature type
+/// @tparam F fallback input subfeature type
+/// @tparam S sysfs units per value unit
+template<int K, int I, int F, int S>
+struct measurement_type
+{
+    static const int input = I;
+    static const int fallback = F;
+    static const int high = SENSORS_SUBFEATURE_UNKNOWN;
+    static const int critical = SENSORS_SUBFEATURE_UNKNOWN;
+    static void store (const feature_values &v, chip_features &f)
+    {
+        f.measurements.push_back (measurement_feature { K, v.current, v.label });
+    }
+    static void store (const feature_attributes &a, chip_attributes &f)
+    {
+        f.measurements.push_back (measurement_attributes { K, a.current, S, a.label });
+    }
+};
+
+/// @brief some power meters only report an average
+template<>
+struct feature_type<SENSORS_FEATURE_POWER>
+    : measurement_type<POWER, SENSORS_SUBFEATURE_POWER_INPUT, SENSORS_SUBFEATURE_POWER_AVERAGE, 1000000> { };
+
+template<>
+struct feature_type<SENSORS_FEATURE_IN>
+    : measurement_type<VOLTAGE, SENSORS_SUBFEATURE_IN_INPUT, SENSORS_SUBFEATURE_UNKNOWN, 1000> { };
+
+template<>
+struct feature_type<SENSORS_FEATURE_CURR>
+    : measurement_type<CURRENT, SENSORS_SUBFEATURE_CURR_INPUT, SENSORS_SUBFEATURE_UNKNOWN, 1000> { };
+
+template<>
+struct feature_type<SENSORS_FEATURE_ENERGY>
+    : measurement_type<ENERGY, SENSORS_SUBFEATURE_ENERGY_INPUT, SENSORS_SUBFEATURE_UNKNOWN, 1000000> { };
+
 /// @brief wrapper for sensors/sensors.h functionality
 class sensors
 {
@@ -73,55 +245,38 @@ class sensors
     typedef const sensors_chip_name *chip;
     /// @brief collection of chips
     typedef std::vector<chip> chips;
-    /// @brief collection of temperature feature
-    typedef std::vector<temperature_feature> temperature_features;
-    /// @brief collection of temperature feature
-    typedef std::vector<fan_speed_feature> fan_speed_features;
-    /// @brief get temperatures for all the cores on a chip
+    /// @brief get all the readings on a chip
     ///
-    /// @param c the chip
+    /// The chip's features and each feature's subfeatures are walked once.
     ///
-    /// @return collection of core temperatures
-    temperature_features get_temperatures (chip c) const
+    /// @param c the chip
+    /// @param f the readings
+    void get_features (chip c, chip_features &f) const
     {
-        temperature_features temps;
-        for (auto feature : get_features (c))
-        {
-            if (feature->type != SENSORS_FEATURE_TEMP)
-                continue;
-            const sensors_subfeature *input = get_subfeature (c, feature, SENSORS_SUBFEATURE_TEMP_INPUT);
-            const sensors_subfeature *max = get_subfeature (c, feature, SENSORS_SUBFEATURE_TEMP_MAX);
-            const sensors_subfeature *crit = get_subfeature (c, feature, SENSORS_SUBFEATURE_TEMP_CRIT);
-            temperature_feature t { -1, -1, -1 };
-            if (input)
-                t.current = get_value (c, input);
-            if (max)
-                t.high = get_value (c, max);
-            if (crit)
-                t.critical = get_value (c, crit);
-            temps.push_back (t);
-        }
-        return temps;
+        f.temps.clear ();
+        f.fan_speeds.clear ();
+        f.measurements.clear ();
+        int feature_num = 0;
+        while (const sensors_feature *feature = sensors_get_features (c, &feature_num))
+            if (const table_entry *e = get_entry (feature->type))
+                (this->*e->read) (c, feature, f);
     }
-    /// @brief get fan speeds for all the cores on a chip
+    /// @brief get the sysfs attributes of all the readings on a chip
     ///
-    /// @param c the chip
+    /// The attributes are in the same order as the values returned by
+    /// get_features ().
     ///
-    /// @return collection of fan speeds
-    fan_speed_features get_fan_speeds (chip c) const
+    /// @param c the chip
+    /// @param a the attributes
+    void get_attributes (chip c, chip_attributes &a) const
     {
-        fan_speed_features fs;
-        for (auto feature : get_features (c))
-        {
-            if (feature->type != SENSORS_FEATURE_FAN)
-                continue;
-            const sensors_subfeature *input = get_subfeature (c, feature, SENSORS_SUBFEATURE_FAN_INPUT);
-            fan_speed_feature f { -1 };
-            if (input)
-                f.current = get_value (c, input);
-            fs.push_back (f);
-        }
-        return fs;
+        a.temps.clear ();
+        a.fan_speeds.clear ();
+        a.measurements.clear ();
+        int feature_num = 0;
+        while (const sensors_feature *feature = sensors_get_features (c, &feature_num))
+            if (const table_entry *e = get_entry (feature->type))
+                (this->*e->read_attributes) (c, feature, a);
     }
     /// @brief get collection of chips of a specific type
     ///
@@ -137,6 +292,110 @@ class sensors
         return c;
     }
     private:
+    /// @brief how to read a kind of feature
+    struct table_entry
+    {
+        void (sensors::*read) (chip, const sensors_feature *, chip_features &) const;
+        void (sensors::*read_attributes) (chip, const sensors_feature *, chip_attributes &) const;
+    };
+    /// @brief get the table entry for a kind of feature
+    ///
+    /// @param type sensors_feature_type
+    ///
+    /// @return the entry, or nullptr if the feature isn't read
+    static const table_entry *get_entry (int type)
+    {
+        static_assert (SENSORS_FEATURE_IN == 0 && SENSORS_FEATURE_FAN == 1 && SENSORS_FEATURE_TEMP == 2
+            && SENSORS_FEATURE_POWER == 3 && SENSORS_FEATURE_ENERGY == 4 && SENSORS_FEATURE_CURR == 5,
+            "the feature table is indexed by sensors_feature_type");
+        static const table_entry table[] =
+        {
+            entry<SENSORS_FEATURE_IN> (),
+            entry<SENSORS_FEATURE_FAN> (),
+            entry<SENSORS_FEATURE_TEMP> (),
+            entry<SENSORS_FEATURE_POWER> (),
+            entry<SENSORS_FEATURE_ENERGY> (),
+            entry<SENSORS_FEATURE_CURR> ()
+        };
+        if (type < 0 || size_t (type) >= sizeof (table) / sizeof (table[0]))
+            return nullptr;
+        return &table[type];
+    }
+    /// @brief make the table entry for a kind of feature
+    ///
+    /// @tparam T sensors_feature_type
+    ///
+    /// @return the entry
+    template<int T>
+    static table_entry entry ()
+    {
+        return table_entry { &sensors::read<feature_type<T> >, &sensors::read_attributes<feature_type<T> > };
+    }
+    /// @brief read the subfeatures of a feature
+    ///
+    /// @tparam F feature_type
+    /// @param c chip name
+    /// @param feature feature
+    /// @param f the readings to add to
+    template<typename F>
+    void read (chip c, const sensors_feature *feature, chip_features &f) const
+    {
+        feature_values v { -1, -1, -1, get_label (c, feature) };
+        double fallback = -1;
+        bool has_input = false;
+        int subfeature_num = 0;
+        while (const sensors_subfeature *s = sensors_get_all_subfeatures (c, feature, &subfeature_num))
+        {
+            const int type = s->type;
+            if (type == F::input)
+            {
+                v.current = get_value (c, s);
+                has_input = true;
+            }
+            else if (type == F::fallback)
+                fallback = get_value (c, s);
+            else if (type == F::high)
+                v.high = get_value (c, s);
+            else if (type == F::critical)
+                v.critical = get_value (c, s);
+        }
+        if (!has_input)
+            v.current = fallback;
+        F::store (v, f);
+    }
+    /// @brief get the sysfs attributes of the subfeatures of a feature
+    ///
+    /// @tparam F feature_type
+    /// @param c chip name
+    /// @param feature feature
+    /// @param a the attributes to add to
+    template<typename F>
+    void read_attributes (chip c, const sensors_feature *feature, chip_attributes &a) const
+    {
+        feature_attributes v;
+        v.label = get_label (c, feature);
+        std::string fallback;
+        if (c->path != nullptr)
+        {
+            const std::string path = std::string (c->path) + "/";
+            int subfeature_num = 0;
+            while (const sensors_subfeature *s = sensors_get_all_subfeatures (c, feature, &subfeature_num))
+            {
+                const int type = s->type;
+                if (type == F::input)
+                    v.current = path + s->name;
+                else if (type == F::fallback)
+                    fallback = path + s->name;
+                else if (type == F::high)
+                    v.high = path + s->name;
+                else if (type == F::critical)
+                    v.critical = path + s->name;
+            }
+        }
+        if (v.current.empty ())
+            v.current = fallback;
+        F::store (v, a);
+    }
     /// @brief get sensors chip names
     ///
     /// @return collection of chip names
@@ -149,48 +408,39 @@ class sensors
             chip_names.push_back (name);
         return chip_names;
     }
-    /// @brief get sensors features
-    ///
-    /// @param name chip name
-    ///
-    /// @return collection of sensors features
-    std::vector<const sensors_feature *> get_features (const sensors_chip_name *name) const
-    {
-        std::vector<const sensors_feature *> features;
-        const sensors_feature *feature;
-        int feature_num = 0;
-        while ((feature = sensors_get_features (name, &feature_num)))
-            features.push_back (feature);
-        return features;
-    }
-    /// @brief get a sensors subfeature
+    /// @brief get the label of a feature
     ///
     /// @param name chip name
     /// @param feature feature
-    /// @param type type of subfeature
     ///
-    /// @return subfeature
-    const sensors_subfeature *get_subfeature (const sensors_chip_name *name, const sensors_feature *feature, sensors_subfeature_type type) const
+    /// @return the label, from the sensors configuration or the driver
+    std::string get_label (const sensors_chip_name *name, const sensors_feature *feature) const
     {
-        const sensors_subfeature *subfeature;
-        if ((subfeature = sensors_get_subfeature (name, feature, type)))
-            return subfeature;
-        else
-            return nullptr;
+        char *label = sensors_get_label (name, feature);
+        if (label == nullptr)
+            return std::string (feature->name);
+        std::string s (label);
+        free (label);
+        return s;
     }
     /// @brief get the value of a subfeature
     ///
+    /// Some readings can't always be read, like the power of a suspended
+    /// gpu, so one that can't is -1, as sensors(1) shows N/A, instead of
+    /// failing the whole scan.  A temperature or fan speed of -1 is a lost
+    /// sensor.
+    ///
     /// @param name chip name
     /// @param subfeature
     ///
-    /// @return subfeature value
+    /// @return subfeature value, or -1 if it could not be read
     double get_value (const sensors_chip_name *name, const sensors_subfeature *subfeature) const
     {
         double value;
         if (!sensors_get_value (name, subfeature->number, &value))
             return value;
         else
-            throw std::runtime_error ("could not get value");
+            return -1;
     }
 };
 
@@ -0,0 +1,173 @@
+/// @file shm.cc
+/// @brief shared memory snapshot publisher and reader
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "shm.h"
+
+namespace therm
+{
+
+void flatten (const busses &bs, shm_snapshot &s)
+{
+    s.busses = s.chips = s.temps = s.fans = s.measurements = 0;
+    for (auto &b : bs)
+    {
+        if (s.busses == MAX_BUSSES)
+            break;
+        shm_bus &sb = s.bus[s.busses++];
+        copy_name (sb.name, b.name);
+        sb.id = b.id;
+        sb.first_chip = s.chips;
+        sb.chips = 0;
+        for (auto &c : b.chips)
+        {
+            if (s.chips == SHM_MAX_CHIPS)
+                break;
+            shm_chip &sc = s.chip[s.chips++];
+            ++sb.chips;
+            copy_name (sc.name, c.name);
+            sc.first_temp = s.temps;
+            sc.temps = 0;
+            for (auto &t : c.temps)
+            {
+                if (s.temps == SHM_MAX_TEMPS)
+                    break;
+                shm_temperature &st = s.temp[s.temps++];
+                st.current = t.current;
+                st.high = t.high;
+                st.critical = t.critical;
+                copy_name (st.label, t.label);
+                ++sc.temps;
+            }
+            sc.first_fan = s.fans;
+            sc.fans = 0;
+            for (auto &f : c.fan_speeds)
+            {
+                if (s.fans == SHM_MAX_FANS)
+                    break;
+                shm_fan_speed &sf = s.fan[s.fans++];
+                sf.current = f.current;
+                copy_name (sf.label, f.label);
+                ++sc.fans;
+            }
+            sc.first_measurement = s.measurements;
+            sc.measurements = 0;
+            for (auto &m : c.measurements)
+            {
+                if (s.measurements == SHM_MAX_MEASUREMENTS)
+                    break;
+                shm_measurement &sm = s.measurement[s.measurements++];
+                sm.current = m.current;
+                sm.kind = m.kind;
+                copy_name (sm.label, m.label);
+                ++sc.measurements;
+            }
+        }
+    }
+}
+
+/// @brief get a name, which may not be terminated
+///
+/// @tparam N size of the name field
+/// @param name the name field
+///
+/// @return the name
+template<size_t N>
+static std::string get_name (const char (&name)[N])
+{
+    return std::string (name, strnlen (name, N));
+}
+
+/// @brief check that a range of a snapshot's array is within it
+///
+/// @param first index of the first element
+/// @param n number of elements
+/// @param size number of elements in the array
+///
+/// @return true if it is
+static bool in_range (uint32_t first, uint32_t n, uint32_t size)
+{
+    return first <= size && n <= size - first;
+}
+
+bool expand (const shm_snapshot &s, busses &bs)
+{
+    if (s.busses > MAX_BUSSES || s.chips > SHM_MAX_CHIPS || s.temps > SHM_MAX_TEMPS
+        || s.fans > SHM_MAX_FANS || s.measurements > SHM_MAX_MEASUREMENTS)
+        return false;
+    for (size_t i = 0; i < s.busses; ++i)
+    {
+        const shm_bus &sb = s.bus[i];
+        if (!in_range (sb.first_chip, sb.chips, s.chips))
+            return false;
+        for (size_t j = 0; j < sb.chips; ++j)
+        {
+            const shm_chip &sc = s.chip[sb.first_chip + j];
+            if (!in_range (sc.first_temp, sc.temps, s.temps)
+                || !in_range (sc.first_fan, sc.fans, s.fans)
+                || !in_range (sc.first_measurement, sc.measurements, s.measurements))
+                return false;
+        }
+    }
+    bs.resize (s.busses);
+    for (size_t i = 0; i < bs.size (); ++i)
+    {
+        const shm_bus &sb = s.bus[i];
+        bus &b = bs[i];
+        b.name = get_name (sb.name);
+        b.id = sb.id;
+        b.chips.resize (sb.chips);
+        for (size_t j = 0; j < b.chips.size (); ++j)
+        {
+            const shm_chip &sc = s.chip[sb.first_chip + j];
+            chip &c = b.chips[j];
+            c.name = get_name (sc.name);
+            c.temps.resize (sc.temps);
+            for (size_t k = 0; k < c.temps.size (); ++k)
+            {
+                const shm_temperature &st = s.temp[sc.first_temp + k];
+                temperature &t = c.temps[k];
+                t.current = st.current;
+                t.high = st.high;
+                t.critical = st.critical;
+                t.label = get_name (st.label);
+            }
+            c.fan_speeds.resize (sc.fans);
+            for (size_t k = 0; k < c.fan_speeds.size (); ++k)
+            {
+                const shm_fan_speed &sf = s.fan[sc.first_fan + k];
+                fan_speed &f = c.fan_speeds[k];
+                f.current = sf.current;
+                f.label = get_name (sf.label);
+            }
+            c.measurements.resize (sc.measurements);
+            for (size_t k = 0; k < c.measurements.size (); ++k)
+            {
+                const shm_measurement &sm = s.measurement[sc.first_measurement + k];
+                measurement &m = c.measurements[k];
+                m.current = sm.current;
+                m.kind = sm.kind;
+                m.label = get_name (sm.label);
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace therm
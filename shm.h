@@ -0,0 +1,417 @@
+/// @file shm.h
+/// @brief shared memory snapshot publisher and reader
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SHM_H
+#define SHM_H
+
+#include "therm.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <memory>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace therm
+{
+
+/// @brief default name of the shared memory segment
+const char *const SHM_NAME = "/therm";
+
+/// @brief shared memory layout identification
+const uint32_t SHM_MAGIC = 0x7468726d;
+const uint32_t SHM_VERSION = 3;
+
+/// @brief fixed capacities of the shared memory layout
+const size_t SHM_NAME_SIZE = 64;
+const size_t SHM_LABEL_SIZE = 32;
+const size_t SHM_MAX_CHIPS = 64;
+const size_t SHM_MAX_TEMPS = 512;
+const size_t SHM_MAX_FANS = 128;
+const size_t SHM_MAX_MEASUREMENTS = 256;
+const size_t SHM_HISTORY = 600;
+
+/// @brief a bus in shared memory
+struct shm_bus
+{
+    char name[SHM_NAME_SIZE];
+    uint32_t id;
+    uint32_t first_chip;
+    uint32_t chips;
+};
+
+/// @brief a chip in shared memory
+struct shm_chip
+{
+    char name[SHM_NAME_SIZE];
+    uint32_t first_temp;
+    uint32_t temps;
+    uint32_t first_fan;
+    uint32_t fans;
+    uint32_t first_measurement;
+    uint32_t measurements;
+};
+
+/// @brief a temperature in shared memory
+struct shm_temperature
+{
+    double current;
+    double high;
+    double critical;
+    char label[SHM_LABEL_SIZE];
+};
+
+/// @brief a fan speed in shared memory
+struct shm_fan_speed
+{
+    double current;
+    char label[SHM_LABEL_SIZE];
+};
+
+/// @brief a power, voltage, current or energy reading in shared memory
+struct shm_measurement
+{
+    double current;
+    uint32_t kind;
+    char label[SHM_LABEL_SIZE];
+};
+
+/// @brief a complete snapshot in shared memory
+struct shm_snapshot
+{
+    /// @brief sample time in ms since the epoch
+    uint64_t time;
+    uint32_t busses;
+    uint32_t chips;
+    uint32_t temps;
+    uint32_t fans;
+    uint32_t measurements;
+    shm_bus bus[MAX_BUSSES];
+    shm_chip chip[SHM_MAX_CHIPS];
+    shm_temperature temp[SHM_MAX_TEMPS];
+    shm_fan_speed fan[SHM_MAX_FANS];
+    shm_measurement measurement[SHM_MAX_MEASUREMENTS];
+};
+
+/// @brief current values of a past snapshot
+struct shm_sample
+{
+    /// @brief sample time in ms since the epoch
+    uint64_t time;
+    float temps[SHM_MAX_TEMPS];
+    float fans[SHM_MAX_FANS];
+    float measurements[SHM_MAX_MEASUREMENTS];
+};
+
+/// @brief the shared memory segment
+///
+/// The segment has a single writer.  Readers never block the writer: they
+/// copy what they need and retry if the sequence number changed while they
+/// were copying.
+struct shm_segment
+{
+    uint32_t magic;
+    uint32_t version;
+    /// @brief process id of the publisher
+    int32_t pid;
+    /// @brief sampling interval in ms
+    uint32_t interval;
+    /// @brief seqlock sequence number, odd while an update is in progress
+    std::atomic<uint32_t> seq;
+    /// @brief number of valid history samples
+    uint32_t samples;
+    /// @brief next history slot to be written
+    uint32_t head;
+    shm_snapshot latest;
+    shm_sample history[SHM_HISTORY];
+};
+
+static_assert (ATOMIC_INT_LOCK_FREE == 2, "shared memory sequence number must be lock free");
+
+/// @brief get the time in ms since the epoch
+///
+/// @return the time
+inline uint64_t now_ms ()
+{
+    timespec ts;
+    clock_gettime (CLOCK_REALTIME, &ts);
+    return uint64_t (ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+/// @brief copy a string into a fixed size field
+///
+/// @param dst destination
+/// @param src source
+template<size_t N>
+inline void copy_name (char (&dst)[N], const std::string &src)
+{
+    const size_t n = std::min (src.size (), N - 1);
+    memcpy (dst, src.c_str (), n);
+    dst[n] = 0;
+}
+
+/// @brief flatten busses into a shared memory snapshot
+///
+/// Sensors that do not fit into the fixed layout are dropped.
+///
+/// @param bs busses
+/// @param s snapshot
+void flatten (const busses &bs, shm_snapshot &s);
+
+/// @brief expand a shared memory snapshot into busses
+///
+/// The snapshot is checked first, since the segment may have been written
+/// by anyone who can write its owner's files.
+///
+/// @param s snapshot
+/// @param bs busses
+///
+/// @return false if the snapshot is not consistent
+bool expand (const shm_snapshot &s, busses &bs);
+
+/// @brief publish snapshots into shared memory
+class shm_publisher
+{
+    private:
+    std::string name;
+    shm_segment *seg;
+    std::unique_ptr<shm_snapshot> tmp;
+    public:
+    /// @brief constructor
+    ///
+    /// @param name segment name
+    /// @param interval sampling interval in ms
+    shm_publisher (const std::string &name, unsigned interval)
+        : name (name)
+        , seg (nullptr)
+        , tmp (new shm_snapshot)
+    {
+        // refuse to take over a segment from a live publisher, but only
+        // trust one owned by root or us, as readers do, so another user
+        // can't keep the publisher from starting
+        int fd = shm_open (name.c_str (), O_RDONLY, 0);
+        if (fd != -1)
+        {
+            struct stat sb;
+            if (fstat (fd, &sb) == 0 && size_t (sb.st_size) == sizeof (shm_segment)
+                && (sb.st_uid == 0 || sb.st_uid == geteuid ()))
+            {
+                void *p = mmap (0, sizeof (shm_segment), PROT_READ, MAP_SHARED, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    const shm_segment *s = static_cast<const shm_segment *> (p);
+                    const pid_t pid = s->pid;
+                    const bool alive = s->magic == SHM_MAGIC && pid > 0 && pid != getpid ()
+                        && (kill (pid, 0) == 0 || errno == EPERM);
+                    munmap (p, sizeof (shm_segment));
+                    if (alive)
+                    {
+                        close (fd);
+                        throw std::runtime_error ("another publisher is using " + name);
+                    }
+                }
+            }
+            close (fd);
+            shm_unlink (name.c_str ());
+        }
+        fd = shm_open (name.c_str (), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd == -1)
+            throw std::runtime_error ("could not create shared memory segment " + name);
+        if (ftruncate (fd, sizeof (shm_segment)) == -1)
+        {
+            close (fd);
+            shm_unlink (name.c_str ());
+            throw std::runtime_error ("could not size shared memory segment");
+        }
+        void *p = mmap (0, sizeof (shm_segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close (fd);
+        if (p == MAP_FAILED)
+        {
+            shm_unlink (name.c_str ());
+            throw std::runtime_error ("could not map shared memory segment");
+        }
+        // the segment is zero filled, so only the header needs to be set
+        seg = new (p) shm_segment;
+        seg->version = SHM_VERSION;
+        seg->pid = getpid ();
+        seg->interval = interval;
+        seg->seq.store (0, std::memory_order_relaxed);
+        seg->samples = 0;
+        seg->head = 0;
+        // readers check the magic number last
+        std::atomic_thread_fence (std::memory_order_release);
+        seg->magic = SHM_MAGIC;
+    }
+    /// @brief destructor
+    ~shm_publisher ()
+    {
+        munmap (seg, sizeof (shm_segment));
+        shm_unlink (name.c_str ());
+    }
+    /// @brief publish a snapshot
+    ///
+    /// @param bs busses
+    void publish (const busses &bs)
+    {
+        // do the work outside of the critical section
+        flatten (bs, *tmp);
+        tmp->time = now_ms ();
+        const uint32_t seq = seg->seq.load (std::memory_order_relaxed);
+        seg->seq.store (seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+        memcpy (&seg->latest, tmp.get (), sizeof (shm_snapshot));
+        shm_sample &h = seg->history[seg->head];
+        h.time = tmp->time;
+        for (size_t i = 0; i < tmp->temps; ++i)
+            h.temps[i] = tmp->temp[i].current;
+        for (size_t i = 0; i < tmp->fans; ++i)
+            h.fans[i] = tmp->fan[i].current;
+        for (size_t i = 0; i < tmp->measurements; ++i)
+            h.measurements[i] = tmp->measurement[i].current;
+        seg->head = (seg->head + 1) % SHM_HISTORY;
+        if (seg->samples < SHM_HISTORY)
+            ++seg->samples;
+        seg->seq.store (seq + 2, std::memory_order_release);
+    }
+};
+
+/// @brief read snapshots from shared memory
+class shm_reader
+{
+    private:
+    const shm_segment *seg;
+    std::unique_ptr<shm_snapshot> tmp;
+    /// @brief seqlock read
+    ///
+    /// @tparam F copy function type
+    /// @param f copy function
+    template<typename F>
+    void read_consistent (F f) const
+    {
+        for (;;)
+        {
+            const uint32_t seq = seg->seq.load (std::memory_order_acquire);
+            if (seq & 1)
+            {
+                sched_yield ();
+                continue;
+            }
+            f ();
+            std::atomic_thread_fence (std::memory_order_acquire);
+            if (seg->seq.load (std::memory_order_relaxed) == seq)
+                return;
+        }
+    }
+    public:
+    /// @brief constructor
+    ///
+    /// @param name segment name
+    shm_reader (const std::string &name)
+        : seg (nullptr)
+        , tmp (new shm_snapshot)
+    {
+        const int fd = shm_open (name.c_str (), O_RDONLY, 0);
+        if (fd == -1)
+            throw std::runtime_error ("could not open shared memory segment " + name);
+        struct stat sb;
+        if (fstat (fd, &sb) == -1 || size_t (sb.st_size) != sizeof (shm_segment))
+        {
+            close (fd);
+            throw std::runtime_error ("shared memory segment has the wrong size");
+        }
+        // anyone can create a segment, so only trust root's or our own
+        if (sb.st_uid != 0 && sb.st_uid != geteuid ())
+        {
+            close (fd);
+            throw std::runtime_error ("shared memory segment " + name + " is owned by another user");
+        }
+        void *p = mmap (0, sizeof (shm_segment), PROT_READ, MAP_SHARED, fd, 0);
+        close (fd);
+        if (p == MAP_FAILED)
+            throw std::runtime_error ("could not map shared memory segment");
+        seg = static_cast<const shm_segment *> (p);
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (seg->magic != SHM_MAGIC || seg->version != SHM_VERSION)
+        {
+            munmap (const_cast<shm_segment *> (seg), sizeof (shm_segment));
+            throw std::runtime_error ("shared memory segment has the wrong version");
+        }
+    }
+    /// @brief destructor
+    ~shm_reader ()
+    {
+        munmap (const_cast<shm_segment *> (seg), sizeof (shm_segment));
+    }
+    /// @brief check if the publisher is still updating the segment
+    ///
+    /// @return true if the publisher is alive and its data is fresh
+    bool is_alive () const
+    {
+        if (kill (seg->pid, 0) == -1 && errno != EPERM)
+            return false;
+        uint64_t time;
+        read_consistent ([&] { time = seg->latest.time; });
+        // allow a few missed updates
+        return time != 0 && now_ms () < time + 3 * seg->interval + 1000;
+    }
+    /// @brief read the latest snapshot
+    ///
+    /// @param bs busses
+    ///
+    /// @return false if nothing has been published yet, or if the snapshot
+    /// is not consistent
+    bool read (busses &bs) const
+    {
+        read_consistent ([&] { memcpy (tmp.get (), &seg->latest, sizeof (shm_snapshot)); });
+        if (tmp->time == 0)
+            return false;
+        return expand (*tmp, bs);
+    }
+    /// @brief read the history, oldest sample first
+    ///
+    /// Sample values are in the same order as the sensors in the latest
+    /// snapshot.
+    ///
+    /// @param h history
+    void read_history (std::vector<shm_sample> &h) const
+    {
+        // the counts may be torn or forged, so don't size by them
+        h.resize (SHM_HISTORY);
+        size_t n = 0;
+        read_consistent ([&]
+        {
+            n = std::min (size_t (seg->samples), SHM_HISTORY);
+            const size_t first = (seg->head % SHM_HISTORY + SHM_HISTORY - n) % SHM_HISTORY;
+            for (size_t i = 0; i < n; ++i)
+                h[i] = seg->history[(first + i) % SHM_HISTORY];
+        });
+        h.resize (n);
+    }
+};
+
+} // namespace therm
+
+#endif
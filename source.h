@@ -0,0 +1,175 @@
+/// @file source.h
+/// @brief where sensor snapshots come from
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include "cache.h"
+#include "cpufreq.h"
+#include "powercap.h"
+#include "shm.h"
+#include <memory>
+#include <string>
+
+namespace therm
+{
+
+/// @brief sensor data source
+///
+/// Snapshots come from a shared memory publisher when one is running.
+/// Otherwise they are read directly from sysfs using a cached topology, or
+/// from libsensors if there is no valid cache.
+class source
+{
+    private:
+    std::string shm_name;
+    std::string cache_fn;
+    std::unique_ptr<shm_reader> reader;
+    std::unique_ptr<topology> cached;
+    std::unique_ptr<sensors> local;
+    std::unique_ptr<powercap> rapl;
+    std::unique_ptr<cpufreq> freq;
+    /// @brief open the local sensors
+    ///
+    /// @param use_cache try the topology cache first
+    void open_local (bool use_cache)
+    {
+        if (!rapl)
+            rapl.reset (new powercap);
+        if (!freq)
+            freq.reset (new cpufreq);
+        if (use_cache && !cache_fn.empty ())
+        {
+            std::unique_ptr<topology> t (new topology);
+            try
+            {
+                read (*t, cache_fn);
+                if (is_valid (*t))
+                {
+                    cached = std::move (t);
+                    return;
+                }
+                std::clog << "topology cache is out of date" << std::endl;
+            }
+            catch (const std::exception &e)
+            {
+                std::clog << e.what () << std::endl;
+            }
+        }
+        local.reset (new sensors);
+        if (cache_fn.empty ())
+            return;
+        topology t;
+        if (resolve (*local, t))
+        {
+            try { write (t, cache_fn); }
+            catch (const std::exception &e) { std::clog << e.what () << std::endl; }
+        }
+        else
+        {
+            std::clog << "topology can't be cached" << std::endl;
+            unlink (cache_fn.c_str ());
+        }
+    }
+    public:
+    /// @brief constructor
+    ///
+    /// @param shm_name shared memory segment name, empty to never use shared memory
+    /// @param cache_fn topology cache filename, empty to never use the cache
+    source (const std::string &shm_name, const std::string &cache_fn = std::string ())
+        : shm_name (shm_name)
+        , cache_fn (cache_fn)
+    {
+        if (!shm_name.empty ())
+        {
+            try { reader.reset (new shm_reader (shm_name)); }
+            catch (const std::exception &) { }
+            if (reader && !reader->is_alive ())
+                reader.reset ();
+        }
+        if (!reader)
+            open_local (true);
+    }
+    /// @brief get the history published with the snapshots
+    ///
+    /// @param h history, oldest sample first, empty if snapshots don't
+    /// come from shared memory
+    void read_history (std::vector<shm_sample> &h) const
+    {
+        if (reader)
+            reader->read_history (h);
+        else
+            h.clear ();
+    }
+    /// @brief get a description of the source
+    ///
+    /// @return the description
+    std::string get_description () const
+    {
+        if (reader)
+            return "shared memory segment " + shm_name;
+        if (cached)
+            return "topology cache " + cache_fn;
+        return "libsensors version " + local->get_version ();
+    }
+    /// @brief get a snapshot
+    ///
+    /// @return vector of bus sensor data
+    busses scan ()
+    {
+        busses bs;
+        scan (bs);
+        return bs;
+    }
+    /// @brief get a snapshot into an existing one
+    ///
+    /// @param bs vector of bus sensor data
+    void scan (busses &bs)
+    {
+        if (reader)
+        {
+            if (reader->is_alive () && reader->read (bs))
+                return;
+            // the publisher went away
+            reader.reset ();
+            open_local (true);
+        }
+        if (cached)
+        {
+            if (therm::scan (*cached, bs))
+            {
+                rapl->scan (bs);
+                freq->scan (bs);
+                return;
+            }
+            // the hardware changed
+            std::clog << "topology cache is out of date" << std::endl;
+            cached.reset ();
+            open_local (false);
+        }
+        therm::scan (*local, bs);
+        rapl->scan (bs);
+        freq->scan (bs);
+    }
+};
+
+} // namespace therm
+
+#endif
@@ -18,21 +18,56 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include "burn.h"
+#include "capture.h"
+#include "html.h"
+#include "net.h"
+#include "remote.h"
+#include "rules.h"
+#include "sampler.h"
+#include "shm.h"
+#include "source.h"
 #include "ui.h"
+#include "wire.h"
+#include <csignal>
+#include <getopt.h>
+#include <memory>
+#include <sys/resource.h>
 
 using namespace std;
 using namespace therm;
 
-template<typename U>
-void main_loop (const sensors &s, options &opts, const string &config_fn)
+const string usage = "usage: therm [-s '...'|--shm='...'] [-l|--local] [-r '...'|--remote='...'] [-o '...'|--html='...'] [-i#|--interval=#] [-c '...'|--capture='...'] [-t '...'|--trigger='...'] [-f#|--frequency=#] [-w#|--window=#] [-u#|--cpu=#] [-p#|--top=#] [-b '...'|--burn='...'] [-e '...'|--cpus='...'] [-v '...'|--levels='...'] [-d#|--step=#] [-?|--help]";
+
+template<typename U,typename S>
+void main_loop (S &s, options &opts, const string &config_fn, const string &fans_fn, unsigned top = 0)
 {
-    U ui (opts);
+    // the processes that use the most cpu are only known locally
+    unique_ptr<top_consumers> t;
+    if (top)
+    {
+        // the processes and cgroups each keep a descriptor open
+        rlimit r;
+        if (getrlimit (RLIMIT_NOFILE, &r) == 0 && r.rlim_cur < r.rlim_max)
+        {
+            r.rlim_cur = r.rlim_max;
+            setrlimit (RLIMIT_NOFILE, &r);
+        }
+        t.reset (new top_consumers (top));
+    }
+    U ui (opts, fans_fn);
+    busses b;
     while (!ui.is_done ())
     {
         // get temps
-        busses b = scan (s);
+        s.scan (b);
         // show them
-        ui.show_temps (b);
+        const int row = ui.show_temps (b, t ? t->size () + 1 : 0);
+        if (t)
+        {
+            t->sample ();
+            ui.show_top (*t, row);
+        }
         // interpret user input
         ui.process (getch (), config_fn);
     }
@@ -40,12 +75,255 @@ void main_loop (const sensors &s, options &opts, const string &config_fn)
     ui.release ();
 }
 
+volatile sig_atomic_t done = 0;
+
+void stop (int)
+{
+    done = 1;
+}
+
+template<typename S>
+void html_loop (S &s, const options &opts, const string &fn, unsigned interval, const string &title, const vector<shm_sample> &history = vector<shm_sample> ())
+{
+    signal (SIGINT, stop);
+    signal (SIGTERM, stop);
+    html_page page (opts, fn, title, interval);
+    busses b;
+    // start the graphs from what thermd has already sampled
+    if (!history.empty ())
+    {
+        s.scan (b);
+        page.seed (b, history);
+    }
+    while (!done)
+    {
+        s.scan (b);
+        page.update (b, now_ms ());
+        usleep (interval * 1000);
+    }
+}
+
+void capture_loop (const string &fn, const string &trigger, unsigned rate, unsigned window, int cpu)
+{
+    // the sensors are read directly from sysfs
+    topology t;
+    if (!load (t, get_config_dir () + "/topology"))
+        throw runtime_error ("the sensors can't be read directly from sysfs, so they can't be captured");
+    busses b;
+    if (!scan (t, b))
+        throw runtime_error ("could not read the sensors");
+    // only capture the sensors that the trigger refers to
+    rule_set rs;
+    rs.add (trigger);
+    const vector<uint32_t> indices = rs.get_sensors (b);
+    if (indices.empty ())
+        throw runtime_error ("the trigger does not refer to any sensors");
+    // where each captured value goes in the snapshot, and its name
+    vector<double *> values;
+    vector<string> names;
+    uint32_t n = 0;
+    for (auto &i : b)
+        for (auto &c : i.chips)
+        {
+            for (auto &x : c.temps)
+                if (binary_search (indices.begin (), indices.end (), n++))
+                {
+                    values.push_back (&x.current);
+                    names.push_back (c.name + ":" + x.label);
+                }
+            for (auto &x : c.fan_speeds)
+                if (binary_search (indices.begin (), indices.end (), n++))
+                {
+                    values.push_back (&x.current);
+                    names.push_back (c.name + ":" + x.label);
+                }
+            for (auto &x : c.measurements)
+                if (binary_search (indices.begin (), indices.end (), n++))
+                {
+                    values.push_back (&x.current);
+                    names.push_back (c.name + ":" + x.label);
+                }
+        }
+    capture cap (t, indices, rate);
+    const size_t samples = static_cast<size_t> (rate) * window / 1000;
+    capture_window w (indices.size () + 1, samples, samples);
+    signal (SIGINT, stop);
+    signal (SIGTERM, stop);
+    if (cpu < 0)
+        cpu = sysconf (_SC_NPROCESSORS_ONLN) - 1;
+    clog << "capturing " << indices.size () << " sensors at " << rate << "Hz on cpu " << cpu << endl;
+    cap.start (cpu);
+    sample_ring &ring = cap.get_ring ();
+    unsigned captures = 0;
+    while (!done)
+    {
+        const double *s = ring.read_slot ();
+        if (s == 0)
+        {
+            usleep (10000);
+            continue;
+        }
+        for (size_t i = 0; i < values.size (); ++i)
+            *values[i] = s[i + 1];
+        rs.evaluate (b, cap.get_start_time () + static_cast<uint64_t> (s[0] / 1e6));
+        const bool triggered = rs.is_changed (0) && rs.is_active (0);
+        if (triggered)
+            clog << "triggered at " << s[0] / 1e6 << "ms" << endl;
+        if (w.add (s, triggered))
+        {
+            const string f = fn + "." + to_string (++captures);
+            w.write (f, names);
+            clog << "wrote " << f << endl;
+        }
+        ring.pop ();
+    }
+    cap.stop ();
+    clog << "overruns=" << cap.get_overruns () << endl;
+    clog << "missed=" << cap.get_missed () << endl;
+}
+
+void burn_loop (const string &fn, const string &cpu_list, const string &level_list, unsigned step, unsigned rate)
+{
+    if (rate == 0 || rate > CAPTURE_MAX_RATE)
+        throw runtime_error ("invalid frequency");
+    const vector<int> cpus = parse_cpus (cpu_list);
+    const vector<double> levels = parse_levels (level_list);
+    // thermd samples too slowly to see the response, so read the sensors
+    // directly
+    source s (string (), get_config_dir () + "/topology");
+    signal (SIGINT, stop);
+    signal (SIGTERM, stop);
+    clog << "loading " << cpus.size () << " cpus at " << levels.size () << " levels for " << step << "s each, sampling at " << rate << "Hz" << endl;
+    load_generator g (cpus);
+    thermal_response r;
+    busses b;
+    for (size_t k = 0; k < levels.size () && !done; ++k)
+    {
+        clog << "load " << levels[k] << "%" << endl;
+        g.set_level (levels[k]);
+        r.begin_level (levels[k]);
+        const uint64_t end = now_ms () + step * 1000ull;
+        while (!done && now_ms () < end)
+        {
+            s.scan (b);
+            r.add (b, now_ms ());
+            usleep (1000000 / rate);
+        }
+    }
+    g.set_level (0);
+    if (done)
+        clog << "interrupted" << endl;
+    if (r.empty ())
+    {
+        clog << "no samples" << endl;
+        return;
+    }
+    r.write (fn);
+    clog << "wrote " << fn << endl;
+    r.report (cout);
+}
+
 int main (int argc, char *argv[])
 {
     try
     {
-        // init the sensors library
-        sensors s;
+        // parse the options
+        string shm_name = SHM_NAME;
+        string remote_host;
+        string html_fn;
+        unsigned interval = 1000;
+        string capture_fn;
+        string trigger;
+        unsigned rate = 100;
+        unsigned window = 2000;
+        int cpu = -1;
+        unsigned top = 0;
+        string burn_fn;
+        string cpu_list;
+        string level_list = "0,25,50,75,100";
+        unsigned step = 120;
+        static struct ::option long_options[] =
+        {
+            {"help", 0, 0, 'h'},
+            {"shm", 1, 0, 's'},
+            {"local", 0, 0, 'l'},
+            {"remote", 1, 0, 'r'},
+            {"html", 1, 0, 'o'},
+            {"interval", 1, 0, 'i'},
+            {"capture", 1, 0, 'c'},
+            {"trigger", 1, 0, 't'},
+            {"frequency", 1, 0, 'f'},
+            {"window", 1, 0, 'w'},
+            {"cpu", 1, 0, 'u'},
+            {"top", 1, 0, 'p'},
+            {"burn", 1, 0, 'b'},
+            {"cpus", 1, 0, 'e'},
+            {"levels", 1, 0, 'v'},
+            {"step", 1, 0, 'd'},
+            {NULL, 0, NULL, 0}
+        };
+        int option_index;
+        int arg;
+        while ((arg = getopt_long (argc, argv, "hs:lr:o:i:c:t:f:w:u:p:b:e:v:d:", long_options, &option_index)) != -1)
+        {
+            switch (arg)
+            {
+                default:
+                    throw runtime_error ("unknown option specified");
+                case 'h':
+                clog << usage << endl;
+                return 0;
+                case 's':
+                shm_name = string (optarg);
+                break;
+                case 'l':
+                shm_name.clear ();
+                break;
+                case 'r':
+                remote_host = string (optarg);
+                break;
+                case 'o':
+                html_fn = string (optarg);
+                break;
+                case 'i':
+                interval = atoi (optarg);
+                if (interval == 0)
+                    throw runtime_error ("invalid interval");
+                break;
+                case 'c':
+                capture_fn = string (optarg);
+                break;
+                case 't':
+                trigger = string (optarg);
+                break;
+                case 'f':
+                rate = atoi (optarg);
+                break;
+                case 'w':
+                window = atoi (optarg);
+                break;
+                case 'u':
+                cpu = atoi (optarg);
+                break;
+                case 'p':
+                top = atoi (optarg);
+                break;
+                case 'b':
+                burn_fn = string (optarg);
+                break;
+                case 'e':
+                cpu_list = string (optarg);
+                break;
+                case 'v':
+                level_list = string (optarg);
+                break;
+                case 'd':
+                step = atoi (optarg);
+                if (step == 0)
+                    throw runtime_error ("invalid step");
+                break;
+            }
+        };
 
         // options get saved here
         string config_fn = get_config_dir () + "/thermrc";
@@ -69,9 +347,52 @@ int main (int argc, char *argv[])
                 read (opts, config_fn);
         }
 
+        // capture the sensors around a trigger
+        if (!capture_fn.empty ())
+        {
+            if (trigger.empty ())
+                throw runtime_error ("a capture needs a trigger");
+            capture_loop (capture_fn, trigger, rate, window, cpu);
+            return 0;
+        }
+
+        // load the cpus and record the response
+        if (!burn_fn.empty ())
+        {
+            burn_loop (burn_fn, cpu_list, level_list, step, rate);
+            return 0;
+        }
+
+        // view a host through a collector
+        if (!remote_host.empty ())
+        {
+            // 'host@addr', or just 'host' for the default collector
+            const size_t at = remote_host.find ('@');
+            const string addr = at == string::npos ? DEFAULT_COLLECTOR : remote_host.substr (at + 1);
+            remote r (addr, remote_host.substr (0, at));
+            // wait for the first snapshot before taking over the terminal
+            busses b;
+            r.scan (b);
+            if (!html_fn.empty ())
+                html_loop (r, opts, html_fn, interval, r.get_description ());
+            else
+                main_loop<ncurses_ui> (r, opts, config_fn, string ());
+            return 0;
+        }
+
+        // attach to the publisher, or init the sensors library
+        sampler s (shm_name, string ());
+
         // run the main loop
-        main_loop<ncurses_ui> (s, opts, config_fn);
-        //main_loop<debug_ui> (s, opts, config_fn);
+        if (!html_fn.empty ())
+        {
+            vector<shm_sample> h;
+            s.read_history (h);
+            html_loop (s, opts, html_fn, interval, get_host_name (), h);
+        }
+        else
+            main_loop<ncurses_ui> (s, opts, config_fn, get_config_dir () + "/fans", top);
+        //main_loop<debug_ui> (s, opts, config_fn, string ());
 
         return 0;
     }
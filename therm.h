@@ -22,6 +22,8 @@
 #define THERM_H
 
 #include "sensors.h"
+#include <cmath>
+#include <cstdio>
 #include <iostream>
 #include <stdexcept>
 #include <string>
@@ -39,7 +41,7 @@ const int MINOR_REVISION = 3;
 /// @param c temperature in celsius
 ///
 /// @return temperature in fahrenheit
-double ctof (const double c)
+inline double ctof (const double c)
 {
     return c * 9.0 / 5.0 + 32.0;
 }
@@ -50,20 +52,68 @@ struct temperature
     double current;
     double high;
     double critical;
+    std::string label;
 };
 
 /// @brief fan speed reading
 struct fan_speed
 {
     double current;
+    std::string label;
 };
 
+/// @brief get the name of a kind of reading
+///
+/// @param kind the kind
+///
+/// @return the name
+inline const char *get_kind_name (int kind)
+{
+    static const char *names[] = { "power", "voltage", "current", "energy", "frequency", "throttle" };
+    return kind >= 0 && kind < MEASUREMENT_KINDS ? names[kind] : "unknown";
+}
+
+/// @brief get the unit of a kind of reading
+///
+/// @param kind the kind
+///
+/// @return the unit
+inline const char *get_unit (int kind)
+{
+    static const char *units[] = { "W", "V", "A", "J", "GHz", "" };
+    return kind >= 0 && kind < MEASUREMENT_KINDS ? units[kind] : "";
+}
+
+/// @brief power, voltage, current, energy, frequency or throttle event reading
+struct measurement
+{
+    int kind;
+    double current;
+    std::string label;
+};
+
+/// @brief format a reading with three or four digits and its unit
+///
+/// Throttle events are counts, so they have no decimals.
+///
+/// @param m the reading
+///
+/// @return the text
+inline std::string format (const measurement &m)
+{
+    char s[32];
+    const double a = std::fabs (m.current);
+    snprintf (s, sizeof (s), a >= 100 || m.kind == THROTTLE ? "%.0f%s" : (a >= 10 ? "%.1f%s" : "%.2f%s"), m.current, get_unit (m.kind));
+    return s;
+}
+
 /// @brief a chip on a bus with sensor data
 struct chip
 {
     std::string name;
     std::vector<temperature> temps;
     std::vector<fan_speed> fan_speeds;
+    std::vector<measurement> measurements;
 };
 
 /// @brief a bus that may have chips
@@ -77,51 +127,45 @@ struct bus
 /// @brief collection of busses
 typedef std::vector<bus> busses;
 
+/// @brief temperature status, also used as thermalert's return code
+enum status
+{
+    NORMAL = 0,
+    HIGH = 1,
+    CRITICAL = 2
+};
+
 /// @brief scan the busses for sensor data
 ///
 /// @param s sensors
 ///
 /// @return vector of bus sensor data
-busses scan (const sensors &s)
-{
-    busses bs;
-    for (short i = 0; i < MAX_BUSSES; ++i)
-    {
-        // get chips on this bus
-        auto chips = s.get_chips (i);
-        if (chips.empty ())
-            continue;
-        // get bus name
-        bus b;
-        sensors_bus_id id { i, 0 };
-        const char *name = sensors_get_adapter_name (&id);
-        if (name == nullptr)
-            b.name = "Unknown";
-        else
-            b.name = name;
-        b.id = i;
-        for (auto c : chips)
-        {
-            chip ch;
-            ch.name = c->prefix;
-            auto temps = s.get_temperatures (c);
-            for (auto t : temps)
-            {
-                temperature temp { t.current, t.high, t.critical };
-                ch.temps.push_back (temp);
-            }
-            auto fss = s.get_fan_speeds (c);
-            for (auto f : fss)
-            {
-                fan_speed fs { f.current };
-                ch.fan_speeds.push_back (fs);
-            }
-            b.chips.push_back (ch);
-        }
-        bs.push_back (b);
-    }
-    return bs;
-}
+busses scan (const sensors &s);
+
+/// @brief scan the busses for sensor data into an existing snapshot
+///
+/// The snapshot's busses, chips and sensor vectors are reused, so scanning
+/// the same topology over and over doesn't grow them.  The chip list and the
+/// labels are still fetched from libsensors on every scan.
+///
+/// @param s sensors
+/// @param bs vector of bus sensor data
+void scan (const sensors &s, busses &bs);
+
+/// @brief get the status of a temperature
+///
+/// @param t temperature
+///
+/// @return the status
+int get_status (const temperature &t);
+
+/// @brief get the worst status of all temperatures
+///
+/// @param bs vector of bus sensor data
+/// @param bus_id only check this bus, or all busses if ~0u
+///
+/// @return the status
+int check (const busses &bs, unsigned bus_id = ~0u);
 
 } // namespace therm
 
@@ -18,18 +18,35 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-#include "therm.h"
+#include "alerts.h"
+#include "fans.h"
+#include "mitigate.h"
+#include "options.h"
+#include "replay.h"
+#include "rules.h"
+#include "sampler.h"
+#include "shm.h"
+#include "top.h"
 #include <cmath>
+#include <csignal>
+#include <ctime>
 #include <getopt.h>
+#include <memory>
+#include <sstream>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
 
 using namespace std;
 using namespace therm;
 
-const string usage = "usage: thermalert [-h '...'|--high_cmd='...'] [-c '...'|--critical_cmd='...'] [-b#|--bus_id=#] [-d#|--debug=#] [-?|--help]";
+const string usage = "usage: thermalert [-h '...'|--high_cmd='...'] [-c '...'|--critical_cmd='...'] [-o '...'|--recovered_cmd='...'] [-g '...'|--fan_cmd='...'] [-e#|--renotify=#] [-x#|--escalate=#] [-f '...'|--state='...'] [-b#|--bus_id=#] [-s '...'|--shm='...'] [-l|--local] [-n|--no_cache] [-r '...'|--rules='...'] [-w#|--watch=#] [-t#|--top=#] [-a|--eval] [-j#|--jobs=#] [-d#|--debug=#] [-?|--help]";
 
-int check (const busses &b, unsigned bus_id)
+/// @brief when checking once, ms of cpu use to report the top processes from
+const unsigned TOP_INTERVAL = 500;
+
+void show (const busses &b, unsigned bus_id)
 {
-    int status = 0;
     for (size_t i = 0; i < b.size (); ++i)
     {
         // skip the bus if specified
@@ -47,21 +64,414 @@ int check (const busses &b, unsigned bus_id)
                     << " " << t.high
                     << " " << t.critical
                     << endl;
-                if (t.critical > 0 && t.current > t.critical)
-                    status = max (status, 2);
-                else if (t.high > 0 && t.current > t.high)
-                    status = max (status, 1);
             }
         }
     }
+}
+
+/// @brief show the processes and cgroups that use the most cpu, and pass
+/// them to the commands in the environment
+///
+/// @param t the processes and cgroups
+void export_top (const top_consumers &t)
+{
+    stringstream ps, gs;
+    clog << "top processes" << endl;
+    for (auto &c : t.get_processes ())
+    {
+        clog << "    " << c << endl;
+        ps << c << '\n';
+    }
+    clog << "top cgroups" << endl;
+    for (auto &c : t.get_cgroups ())
+    {
+        clog << "    " << c << endl;
+        gs << c << '\n';
+    }
+    setenv ("THERM_TOP_PROCESSES", ps.str ().c_str (), 1);
+    setenv ("THERM_TOP_CGROUPS", gs.str ().c_str (), 1);
+}
+
+/// @brief decide what to tell the user, given what was already reported
+///
+/// @param state alert state kept between runs
+/// @param b the snapshot
+/// @param bus_id only check this bus, or all busses if ~0u
+/// @param rs compiled rules, already evaluated
+/// @param time time of the snapshot in ms
+/// @param notify set to which rules' commands should run
+/// @param recovered set to true if a sensor recovered
+///
+/// @return the status to notify at
+int get_notices (alert_state &state, const busses &b, unsigned bus_id, const rule_set &rs, uint64_t time, vector<bool> &notify, bool &recovered)
+{
+    int status = NORMAL;
+    recovered = false;
+    for (auto &bus : b)
+    {
+        // skip the bus if specified
+        if (bus_id != ~0u && bus_id != bus.id)
+            continue;
+        for (size_t i = 0; i < bus.chips.size (); ++i)
+        {
+            const chip &c = bus.chips[i];
+            const string name = to_string (bus.id) + '/' + to_string (i) + '/' + c.name + '/';
+            for (auto &t : c.temps)
+            {
+                switch (state.update (get_alert_key (name + t.label), get_status (t), time))
+                {
+                    case NOTICE_NONE:
+                    break;
+                    case NOTICE_HIGH:
+                    status = max (status, int (HIGH));
+                    break;
+                    case NOTICE_CRITICAL:
+                    if (get_status (t) == HIGH)
+                        clog << "escalated: " << c.name << " " << t.label << endl;
+                    status = CRITICAL;
+                    break;
+                    case NOTICE_RECOVERED:
+                    clog << "recovered: " << c.name << " " << t.label << endl;
+                    recovered = true;
+                    break;
+                }
+            }
+        }
+    }
+    notify.assign (rs.size (), false);
+    for (size_t i = 0; i < rs.size (); ++i)
+    {
+        const alert_notice n = state.update (get_alert_key ("rule/" + rs.get_expression (i)), rs.is_active (i) ? HIGH : NORMAL, time);
+        if (n == NOTICE_RECOVERED)
+            clog << "rule cleared: " << rs.get_expression (i) << endl;
+        notify[i] = n == NOTICE_HIGH || n == NOTICE_CRITICAL;
+    }
     return status;
 }
 
-void execute (const string &cmd)
+/// @brief report the fans that are not healthy
+///
+/// @param fans fan model, already updated with the snapshot
+/// @param b the snapshot
+/// @param bus_id only report fans on this bus, or on all busses if ~0u
+/// @param state alert state kept between runs, or nullptr
+/// @param previous the health of each fan in the previous snapshot, when
+/// watching, or nullptr
+/// @param time time of the snapshot in ms
+///
+/// @return true if a fan was reported
+bool check_fans (const fan_model &fans, const busses &b, unsigned bus_id, alert_state *state, vector<uint8_t> *previous, uint64_t time)
 {
+    // a fan that stays bad is reported again only after it has recovered
+    if (previous)
+        previous->resize (fans.get_health ().size (), HEALTH_LEARNING);
+    bool reported = false;
+    size_t n = 0;
+    for (auto &bus : b)
+        for (size_t i = 0; i < bus.chips.size (); ++i)
+        {
+            const chip &c = bus.chips[i];
+            const string name = "fan/" + to_string (bus.id) + '/' + to_string (i) + '/' + c.name + '/';
+            for (auto &f : c.fan_speeds)
+            {
+                const size_t j = n++;
+                // skip the bus if specified
+                if (bus_id != ~0u && bus_id != bus.id)
+                    continue;
+                const fan_health h = fan_health (fans.get_health ()[j]);
+                const int status = h == HEALTH_STALLED ? CRITICAL : (h == HEALTH_DEGRADED || h == HEALTH_PINNED ? HIGH : NORMAL);
+                alert_notice notice = status == NORMAL ? NOTICE_NONE : NOTICE_HIGH;
+                if (state)
+                    notice = state->update (get_alert_key (name + f.label), status, time);
+                else if (previous)
+                {
+                    const fan_health p = fan_health ((*previous)[j]);
+                    if (p == h)
+                        notice = NOTICE_NONE;
+                    else if (status == NORMAL && (p == HEALTH_STALLED || p == HEALTH_DEGRADED || p == HEALTH_PINNED))
+                        notice = NOTICE_RECOVERED;
+                }
+                if (notice == NOTICE_RECOVERED)
+                    clog << "fan recovered: " << c.name << " " << f.label << endl;
+                if (notice == NOTICE_NONE || notice == NOTICE_RECOVERED)
+                    continue;
+                clog << "fan " << get_name (h) << ": " << c.name << " " << f.label << " "
+                    << lround (f.current) << " RPM, expected " << lround (fans.get_expected ()[j]) << " RPM" << endl;
+                reported = true;
+            }
+        }
+    if (previous)
+        *previous = fans.get_health ();
+    return reported;
+}
+
+/// @brief get the processes and cgroups that use the most cpu
+///
+/// @param top how many of each to keep
+///
+/// @return the processes and cgroups
+unique_ptr<top_consumers> get_top (unsigned top)
+{
+    // the processes and cgroups each keep a descriptor open
+    rlimit r;
+    if (getrlimit (RLIMIT_NOFILE, &r) == 0 && r.rlim_cur < r.rlim_max)
+    {
+        r.rlim_cur = r.rlim_max;
+        setrlimit (RLIMIT_NOFILE, &r);
+    }
+    return unique_ptr<top_consumers> (new top_consumers (top));
+}
+
+void execute (const string &cmd, const top_consumers *t)
+{
+    if (t)
+        export_top (*t);
     clog << "executing '" << cmd << "'" << endl;
+    // a command that can't run must not stop the next alert
     if (system (cmd.c_str ()) == -1)
-        throw runtime_error ("could not execute command");
+        clog << "could not execute '" << cmd << "'" << endl;
+}
+
+/// @brief run the commands of the rules that became active
+///
+/// @param rs compiled rules
+/// @param rules the rules
+/// @param t the processes and cgroups that use the most cpu, or nullptr
+/// @param notify which rules to run the commands of, instead of the ones
+/// that became active, or nullptr
+void run_rules (const rule_set &rs, const vector<rule> &rules, const top_consumers *t, const vector<bool> *notify = nullptr)
+{
+    for (size_t i = 0; i < rs.size (); ++i)
+    {
+        if (notify ? !(*notify)[i] : !rs.is_changed (i))
+            continue;
+        if (!rs.is_active (i))
+        {
+            clog << "rule cleared: " << rs.get_expression (i) << endl;
+            continue;
+        }
+        clog << "rule active: " << rs.get_expression (i) << endl;
+        if (!rules[i].command.empty ())
+            execute (rules[i].command, t);
+    }
+}
+
+/// @brief the built in actions of the rules
+class actions
+{
+    private:
+    struct rule_action
+    {
+        size_t rule;
+        std::string command;
+        action a;
+        /// @brief index of its 'until' expression, or -1
+        int until;
+    };
+    vector<rule_action> list;
+    rule_set untils;
+    unique_ptr<mitigator> m;
+    public:
+    /// @brief constructor
+    ///
+    /// Actions are taken out of the rules, so their commands aren't run by
+    /// the shell.
+    ///
+    /// @param rules the rules
+    actions (vector<rule> &rules)
+    {
+        for (size_t i = 0; i < rules.size (); ++i)
+        {
+            rule_action x { i, rules[i].command, action (), -1 };
+            if (!parse_action (x.command, x.a))
+                continue;
+            if (!x.a.until.empty ())
+                x.until = untils.add (x.a.until);
+            list.push_back (x);
+            rules[i].command.clear ();
+        }
+    }
+    /// @brief get ready to apply the actions
+    ///
+    /// If there are any, actions left applied by a previous run are
+    /// undone.  Throws if another thermalert is applying actions.
+    void start ()
+    {
+        if (!list.empty ())
+            m.reset (new mitigator (get_config_dir () + "/mitigation"));
+    }
+    /// @brief check if there are any actions
+    ///
+    /// @return true if there are none
+    bool empty () const
+    {
+        return list.empty ();
+    }
+    /// @brief apply the actions of the rules that became active, and undo
+    /// the ones whose rules cleared or whose 'until' became true
+    ///
+    /// @param rs compiled rules, already evaluated
+    /// @param b the snapshot
+    /// @param time time of the snapshot in ms
+    void run (const rule_set &rs, const busses &b, uint64_t time)
+    {
+        if (!m)
+            return;
+        if (untils.size ())
+            untils.evaluate (b, time);
+        for (size_t k = 0; k < list.size (); ++k)
+        {
+            const rule_action &x = list[k];
+            if (!m->is_applied (k))
+            {
+                if (!rs.is_changed (x.rule) || !rs.is_active (x.rule))
+                    continue;
+                clog << "applying '" << x.command << "'" << endl;
+                m->apply (k, x.a, b);
+            }
+            else if (x.until == -1 ? !rs.is_active (x.rule) : untils.is_active (x.until))
+            {
+                clog << "undoing '" << x.command << "'" << endl;
+                m->undo (k);
+            }
+        }
+    }
+};
+
+/// @brief format a time
+///
+/// @param ms time in ms since the epoch
+///
+/// @return the local time
+string format_time (uint64_t ms)
+{
+    const time_t t = ms / 1000;
+    tm local;
+    char buf[32];
+    localtime_r (&t, &local);
+    strftime (buf, sizeof (buf), "%F %T", &local);
+    return buf;
+}
+
+/// @brief format a duration
+///
+/// @param ms the duration in ms
+///
+/// @return hours, minutes and seconds
+string format_duration (uint64_t ms)
+{
+    const uint64_t s = ms / 1000;
+    stringstream ss;
+    if (s >= 3600)
+        ss << s / 3600 << "h ";
+    if (s >= 60)
+        ss << s / 60 % 60 << "m ";
+    ss << s % 60 << "s";
+    return ss.str ();
+}
+
+/// @brief show what a recording would have alerted about
+///
+/// @param s the summary
+/// @param rs compiled rules
+///
+/// @return the worst status of the recording
+int show (const replay_summary &s, const rule_set &rs)
+{
+    cout << (s.host.empty () ? s.fn : s.host) << endl;
+    if (!s.error.empty ())
+    {
+        cout << "    " << s.error << endl;
+        return NORMAL;
+    }
+    if (s.snapshots == 0)
+    {
+        cout << "    no snapshots" << endl;
+        return NORMAL;
+    }
+    cout << "    " << s.snapshots << " snapshots from " << format_time (s.first) << " to " << format_time (s.last) << endl;
+    cout << "    peak " << s.peak << "C " << s.peak_chip << " " << s.peak_label << " at " << format_time (s.peak_time) << endl;
+    cout << "    above high " << format_duration (s.high_time) << ", above critical " << format_duration (s.critical_time) << endl;
+    int status = NORMAL;
+    for (auto &i : s.intervals)
+    {
+        cout << "    " << format_time (i.begin) << " to " << format_time (i.end) << " (" << format_duration (i.end - i.begin) << ") ";
+        if (i.rule == -1)
+        {
+            cout << (i.status == CRITICAL ? "critical" : "high") << endl;
+            status = max (status, i.status);
+        }
+        else
+            cout << "rule " << rs.get_expression (i.rule) << endl;
+    }
+    return status;
+}
+
+/// @brief save what was learned about the fans, logging if it can't be
+///
+/// @param fans the fan model
+void save_fans (fan_model &fans)
+{
+    try { fans.save (); }
+    catch (const exception &e) { clog << e.what () << endl; }
+}
+
+volatile sig_atomic_t done = 0;
+
+void stop (int)
+{
+    done = 1;
+}
+
+void watch (sampler &s, unsigned interval, unsigned bus_id, const string &high_cmd, const string &critical_cmd, const string &fan_cmd, rule_set &rs, const vector<rule> &rules, actions &as, top_consumers *t)
+{
+    fan_model fans (get_config_dir () + "/fans");
+    uint64_t fans_saved = now_ms ();
+    vector<uint8_t> health;
+    signal (SIGINT, stop);
+    signal (SIGTERM, stop);
+    // the worst state entered by any sensor during a scan, so a whole
+    // package getting hot runs the command once, not once per core
+    int entered = NORMAL;
+    s.get_events ().subscribe ([&] (const event &e)
+    {
+        if (bus_id != ~0u && bus_id != e.id.bus_id)
+            return;
+        clog << e << endl;
+        if (e.type == ENTERED_HIGH)
+            entered = max (entered, int (HIGH));
+        else if (e.type == ENTERED_CRITICAL)
+            entered = CRITICAL;
+    });
+    busses b;
+    while (!done)
+    {
+        if (t)
+            t->sample ();
+        entered = NORMAL;
+        s.scan (b);
+        if (entered == HIGH && !high_cmd.empty ())
+            execute (high_cmd, t);
+        else if (entered == CRITICAL && !critical_cmd.empty ())
+            execute (critical_cmd, t);
+        if (rs.size ())
+        {
+            const uint64_t time = now_ms ();
+            rs.evaluate (b, time);
+            run_rules (rs, rules, t);
+            as.run (rs, b, time);
+        }
+        fans.update (b);
+        if (check_fans (fans, b, bus_id, nullptr, &health, now_ms ()) && !fan_cmd.empty ())
+            execute (fan_cmd, t);
+        if (now_ms () - fans_saved > FAN_SAVE_INTERVAL)
+        {
+            save_fans (fans);
+            fans_saved = now_ms ();
+        }
+        usleep (interval * 1000);
+    }
+    save_fans (fans);
 }
 
 int main (int argc, char **argv)
@@ -72,19 +482,47 @@ int main (int argc, char **argv)
         int debug = 0;
         string high_cmd;
         string critical_cmd;
+        string recovered_cmd;
+        string fan_cmd;
+        unsigned renotify = 60;
+        unsigned escalate = 0;
+        // the default is in the config directory, which is only created
+        // when it's needed
+        string state_fn;
+        bool default_state = true;
         unsigned bus_id = ~0u;
-        static struct option options[] =
+        string shm_name = SHM_NAME;
+        bool use_cache = true;
+        unsigned watch_interval = 0;
+        string rules_fn;
+        unsigned top = 5;
+        bool eval = false;
+        unsigned jobs = thread::hardware_concurrency ();
+        static struct ::option options[] =
         {
             {"help", 0, 0, 'h'},
             {"debug", 1, 0, 'd'},
             {"high_cmd", 1, 0, 'i'},
             {"critical_cmd", 1, 0, 'c'},
+            {"recovered_cmd", 1, 0, 'o'},
+            {"fan_cmd", 1, 0, 'g'},
+            {"renotify", 1, 0, 'e'},
+            {"escalate", 1, 0, 'x'},
+            {"state", 1, 0, 'f'},
             {"bus", 1, 0, 'b'},
+            {"shm", 1, 0, 's'},
+            {"local", 0, 0, 'l'},
+            {"no_cache", 0, 0, 'n'},
+            {"rules", 1, 0, 'r'},
+            {"watch", 1, 0, 'w'},
+            {"top", 1, 0, 't'},
+            {"eval", 0, 0, 'a'},
+            {"jobs", 1, 0, 'j'},
             {NULL, 0, NULL, 0}
         };
         int option_index;
         int arg;
-        while ((arg = getopt_long (argc, argv, "hd:i:c:b:", options, &option_index)) != -1)
+        while ((arg = getopt_long (argc, argv, "hd:i:c:o:g:e:x:f:b:s:lnr:w:t:aj:", options, &option_index)) != -1)
         {
             switch (arg)
             {
@@ -102,9 +540,49 @@ int main (int argc, char **argv)
                 case 'c':
                 critical_cmd = string (optarg);
                 break;
+                case 'o':
+                recovered_cmd = string (optarg);
+                break;
+                case 'g':
+                fan_cmd = string (optarg);
+                break;
+                case 'e':
+                renotify = atoi (optarg);
+                break;
+                case 'x':
+                escalate = atoi (optarg);
+                break;
+                case 'f':
+                state_fn = string (optarg);
+                default_state = false;
+                break;
                 case 'b':
                 bus_id = atoi (optarg);
                 break;
+                case 's':
+                shm_name = string (optarg);
+                break;
+                case 'l':
+                shm_name.clear ();
+                break;
+                case 'n':
+                use_cache = false;
+                break;
+                case 'r':
+                rules_fn = string (optarg);
+                break;
+                case 'w':
+                watch_interval = atoi (optarg);
+                break;
+                case 't':
+                top = atoi (optarg);
+                break;
+                case 'a':
+                eval = true;
+                break;
+                case 'j':
+                jobs = atoi (optarg);
+                break;
             }
         };
 
@@ -115,40 +593,175 @@ int main (int argc, char **argv)
         clog << "debug=" << debug << endl;
         clog << "high_cmd=\"" << high_cmd << "\"" << endl;
         clog << "critical_cmd=\"" << critical_cmd << "\"" << endl;
+        clog << "recovered_cmd=\"" << recovered_cmd << "\"" << endl;
+        clog << "fan_cmd=\"" << fan_cmd << "\"" << endl;
+        clog << "renotify=" << renotify << endl;
+        clog << "escalate=" << escalate << endl;
+        clog << "state=\"" << state_fn << "\"" << endl;
         clog << "bus_id=" << bus_id << endl;
+        clog << "shm=\"" << shm_name << "\"" << endl;
+        clog << "use_cache=" << use_cache << endl;
+        clog << "rules=\"" << rules_fn << "\"" << endl;
+        clog << "watch=" << watch_interval << endl;
+        clog << "top=" << top << endl;
+        clog << "eval=" << eval << endl;
+        clog << "jobs=" << jobs << endl;
+
+        // compile the rules before touching the sensors, so mistakes show
+        // up right away
+        vector<rule> rules;
+        rule_set rs;
+        if (!rules_fn.empty ())
+        {
+            rules = read_rules (rules_fn);
+            for (auto &r : rules)
+                rs.add (r.expression);
+            clog << rs.size () << " rules" << endl;
+        }
+
+        // evaluate recordings instead of the sensors
+        if (eval)
+        {
+            vector<string> fns (argv + optind, argv + argc);
+            vector<string> expressions;
+            for (auto &r : rules)
+                expressions.push_back (r.expression);
+            clog << "evaluating " << fns.size () << " recordings" << endl;
+            int status = NORMAL;
+            for (auto &s : replay (fns, expressions, bus_id, jobs))
+                status = max (status, show (s, rs));
+            return status;
+        }
+
+        actions as (rules);
+
+        // attach to the publisher, or read the cached topology, or init
+        // the sensors library
+        sampler s (shm_name, use_cache ? get_config_dir () + "/topology" : string ());
+
+        // the processes that use the most cpu are passed to the commands,
+        // and when checking once, only found if there is something to
+        // report
+        unique_ptr<top_consumers> t;
+
+        // keep running, and only alert when a sensor changes state
+        if (watch_interval)
+        {
+            as.start ();
+            if (top)
+                t = get_top (top);
+            clog << "reading from " << s.get_description () << endl;
+            watch (s, watch_interval, bus_id, high_cmd, critical_cmd, fan_cmd, rs, rules, as, t.get ());
+            return 0;
+        }
 
-        // init the sensors library
-        sensors s;
-        busses b = scan (s);
+        // actions have to be undone later
+        if (!as.empty ())
+            clog << "built in actions only work with --watch" << endl;
+
+        busses b;
+        s.scan (b);
 
         // return code
         int status;
+        // the status to notify at, which is less than the status if it was
+        // already reported
+        int notice;
+        vector<bool> notify;
+        bool recovered = false;
+        bool fan_alert = false;
+        // saved after the commands run, so a state that can't be saved
+        // doesn't keep them from running
+        unique_ptr<alert_state> state;
+        unique_ptr<fan_model> fans;
 
         // don't check if you are debugging
         if (debug)
-            status = debug;
+            status = notice = debug;
         else
         {
-            clog << "libsensors version " << s.get_version () << endl;
+            clog << "reading from " << s.get_description () << endl;
             clog << "checking temperatures" <<  endl;
-            status = check (b, bus_id);
+            show (b, bus_id);
+            status = notice = check (b, bus_id);
+            const uint64_t time = now_ms ();
+            // rules with a duration need watch mode to become active
+            if (rs.size ())
+                rs.evaluate (b, time);
+            if (default_state)
+                state_fn = get_config_dir () + "/alerts";
+            // learn the fans' speeds, and check them against what was
+            // learned, leaving the model alone if there are no fans
+            bool has_fans = false;
+            for (auto &i : b)
+                for (auto &c : i.chips)
+                    has_fans = has_fans || !c.fan_speeds.empty ();
+            if (has_fans)
+            {
+                fans.reset (new fan_model (get_config_dir () + "/fans"));
+                fans->update (b);
+            }
+            if (!state_fn.empty ())
+            {
+                state.reset (new alert_state (state_fn, renotify * 60000ull, escalate * 60000ull));
+                notice = get_notices (*state, b, bus_id, rs, time, notify, recovered);
+            }
+            if (fans)
+                fan_alert = check_fans (*fans, b, bus_id, state.get (), nullptr, time);
         }
 
+        // let the cpu use add up for a moment before reporting it
+        bool alert = notice != NORMAL || (fan_alert && !fan_cmd.empty ());
+        for (size_t i = 0; i < rs.size (); ++i)
+            alert = alert || (notify.empty () ? rs.is_active (i) : notify[i]);
+        if (top && alert)
+        {
+            t = get_top (top);
+            usleep (TOP_INTERVAL * 1000);
+            t->sample ();
+        }
+        if (!debug)
+            run_rules (rs, rules, t.get (), notify.empty () ? nullptr : &notify);
+
         switch (status)
         {
             default:
-            case 0:
+            case NORMAL:
             clog << "temperatures are normal" << endl;
             break;
-            case 1:
+            case HIGH:
             clog << "temperatures are high" << endl;
-            execute (high_cmd);
             break;
-            case 2:
+            case CRITICAL:
             clog << "temperatures are critical" << endl;
-            execute (critical_cmd);
             break;
         }
+        switch (notice)
+        {
+            default:
+            case NORMAL:
+            if (status != NORMAL)
+                clog << "already reported" << endl;
+            break;
+            case HIGH:
+            execute (high_cmd, t.get ());
+            break;
+            case CRITICAL:
+            execute (critical_cmd, t.get ());
+            break;
+        }
+        if (recovered && !recovered_cmd.empty ())
+            execute (recovered_cmd, nullptr);
+        if (fan_alert && !fan_cmd.empty ())
+            execute (fan_cmd, t.get ());
+
+        if (state)
+        {
+            try { state->save (); }
+            catch (const exception &e) { clog << e.what () << endl; }
+        }
+        if (fans)
+            save_fans (*fans);
 
         return status;
     }
@@ -0,0 +1,530 @@
+/// @file thermcollect.cc
+/// @brief collect snapshots from many hosts
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "net.h"
+#include "shm.h"
+#include "wire.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <getopt.h>
+#include <map>
+#include <memory>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace therm;
+
+const string usage = "usage: thermcollect [-l '...'|--listen='...'] [-d '...'|--dir='...'] [-?|--help]";
+
+/// @brief stop sending updates to a viewer with this many unsent bytes
+const size_t MAX_BACKLOG = 1 << 20;
+
+/// @brief write a host's recording when it has this many bytes
+const size_t RECORD_BATCH = 1 << 16;
+
+/// @brief or when it has waited this many ms
+const uint64_t RECORD_INTERVAL = 5000;
+
+volatile sig_atomic_t done = 0;
+
+void stop (int)
+{
+    done = 1;
+}
+
+struct connection;
+
+/// @brief the latest snapshot of a host
+struct host
+{
+    string name;
+    /// @brief topology and values, with all deltas applied
+    wire_decoder decoder;
+    vector<connection *> viewers;
+    /// @brief frames waiting to be recorded
+    vector<char> record;
+    bool topology_recorded;
+    uint64_t recorded;
+};
+
+/// @brief a socket
+struct connection
+{
+    int fd;
+    bool listener;
+    frame_reader in;
+    /// @brief frames waiting to be sent, and how many bytes of them were sent
+    vector<char> out;
+    size_t sent;
+    /// @brief registered for EPOLLOUT
+    bool waiting;
+    /// @brief in the list of connections to flush
+    bool queued;
+    /// @brief the viewer missed updates and needs all values
+    bool resync;
+    /// @brief the host an agent sends
+    host *agent_of;
+    /// @brief the host a viewer watches
+    host *viewer_of;
+};
+
+/// @brief collector state
+class collector
+{
+    private:
+    int ep;
+    string dir;
+    map<string, host> hosts;
+    vector<unique_ptr<connection>> connections;
+    vector<connection *> dirty;
+    vector<connection *> closed;
+
+    /// @brief add a socket
+    ///
+    /// @param fd the socket
+    /// @param listener true if it is a listening socket
+    void add (int fd, bool listener)
+    {
+        set_nonblocking (fd);
+        unique_ptr<connection> c (new connection);
+        c->fd = fd;
+        c->listener = listener;
+        c->sent = 0;
+        c->waiting = c->queued = c->resync = false;
+        c->agent_of = c->viewer_of = nullptr;
+        epoll_event e;
+        e.events = EPOLLIN;
+        e.data.ptr = c.get ();
+        if (epoll_ctl (ep, EPOLL_CTL_ADD, fd, &e) == -1)
+        {
+            ::close (fd);
+            throw runtime_error ("could not add socket to epoll");
+        }
+        connections.push_back (move (c));
+    }
+    /// @brief close a connection
+    ///
+    /// The connection is freed at the end of the loop iteration, since
+    /// pending events may still refer to it.
+    ///
+    /// @param c the connection
+    void close (connection *c)
+    {
+        if (c->fd == -1)
+            return;
+        ::close (c->fd);
+        c->fd = -1;
+        if (c->viewer_of)
+        {
+            auto &v = c->viewer_of->viewers;
+            v.erase (remove (v.begin (), v.end (), c), v.end ());
+        }
+        closed.push_back (c);
+    }
+    /// @brief queue a connection to be flushed
+    ///
+    /// @param c the connection
+    void queue (connection *c)
+    {
+        if (c->queued)
+            return;
+        c->queued = true;
+        dirty.push_back (c);
+    }
+    /// @brief accept new connections
+    ///
+    /// @param l the listening socket
+    void accept (connection *l)
+    {
+        for (;;)
+        {
+            const int fd = accept4 (l->fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd == -1)
+            {
+                if (errno == EMFILE || errno == ENFILE)
+                    clog << "too many connections" << endl;
+                return;
+            }
+            add (fd, false);
+        }
+    }
+    /// @brief handle a frame
+    ///
+    /// @param c the connection it came from
+    /// @param f the frame
+    void handle (connection *c, const frame_view &f)
+    {
+        if (!f.is_valid ())
+            throw runtime_error ("invalid frame");
+        switch (f.type ())
+        {
+            case WIRE_SUBSCRIBE:
+            {
+                // only agents add hosts, so viewers can't grow the map
+                auto i = hosts.find (get_host (f));
+                if (i == hosts.end ())
+                    throw runtime_error ("unknown host");
+                host &h = i->second;
+                if (c->viewer_of)
+                    return;
+                c->viewer_of = &h;
+                c->resync = true;
+                h.viewers.push_back (c);
+                queue (c);
+            }
+            break;
+            case WIRE_TOPOLOGY:
+            {
+                host &h = find_host (get_name (f.topology ().host));
+                c->agent_of = &h;
+                h.decoder.update (f);
+                h.topology_recorded = false;
+                // viewers get the new topology with the next values
+                for (auto v : h.viewers)
+                    v->resync = true;
+            }
+            break;
+            case WIRE_VALUES:
+            case WIRE_DELTA:
+            {
+                host *h = c->agent_of;
+                if (!h || !h->decoder.update (f))
+                    return;
+                forward (*h, f);
+                if (!dir.empty ())
+                    record (*h);
+            }
+            break;
+        }
+    }
+    /// @brief check that a host name can name its recording
+    ///
+    /// Names come from the agents and viewers, so one that could name a
+    /// file outside the recording directory is refused.
+    ///
+    /// @param name the name
+    ///
+    /// @return true if it can
+    static bool is_valid_host (const string &name)
+    {
+        if (name.empty () || name[0] == '.')
+            return false;
+        for (unsigned char ch : name)
+            if (ch == '/' || ch < ' ' || ch == 0x7f)
+                return false;
+        return true;
+    }
+    /// @brief get a host by name
+    ///
+    /// @param name the name
+    ///
+    /// @return the host
+    host &find_host (const string &name)
+    {
+        if (!is_valid_host (name))
+            throw runtime_error ("invalid host name");
+        auto i = hosts.find (name);
+        if (i != hosts.end ())
+            return i->second;
+        host &h = hosts[name];
+        h.name = name;
+        h.topology_recorded = false;
+        h.recorded = now_ms ();
+        return h;
+    }
+    /// @brief get a host name from a fixed size field
+    ///
+    /// @param s the field
+    ///
+    /// @return the name
+    static string get_name (const char *s)
+    {
+        return string (s, strnlen (s, WIRE_HOST_SIZE));
+    }
+    /// @brief send an update to a host's viewers
+    ///
+    /// Viewers that are too far behind miss updates, and get all values
+    /// once they catch up.
+    ///
+    /// @param h the host
+    /// @param f the values or delta frame
+    void forward (host &h, const frame_view &f)
+    {
+        const char *p = reinterpret_cast<const char *> (&f.header ());
+        for (auto v : h.viewers)
+        {
+            if (v->out.size () - v->sent > MAX_BACKLOG)
+                v->resync = true;
+            if (!v->resync)
+                v->out.insert (v->out.end (), p, p + f.size ());
+            queue (v);
+        }
+    }
+    /// @brief add a host's values to its recording
+    ///
+    /// @param h the host
+    void record (host &h)
+    {
+        if (!h.topology_recorded)
+        {
+            auto &t = h.decoder.get_topology ();
+            h.record.insert (h.record.end (), t.begin (), t.end ());
+            h.topology_recorded = true;
+        }
+        auto &v = h.decoder.get_values ();
+        h.record.insert (h.record.end (), v.begin (), v.end ());
+        if (h.record.size () >= RECORD_BATCH)
+            write_record (h);
+    }
+    /// @brief write a host's recording
+    ///
+    /// @param h the host
+    void write_record (host &h)
+    {
+        h.recorded = now_ms ();
+        if (h.record.empty ())
+            return;
+        const string fn = dir + "/" + h.name + ".therm";
+        const int fd = open (fn.c_str (), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd == -1 || write (fd, &h.record[0], h.record.size ()) != ssize_t (h.record.size ()))
+            clog << "could not write to " << fn << endl;
+        if (fd != -1)
+            ::close (fd);
+        h.record.clear ();
+    }
+    /// @brief send what is queued for a connection
+    ///
+    /// @param c the connection
+    void flush (connection *c)
+    {
+        c->queued = false;
+        if (c->fd == -1)
+            return;
+        host *h = c->viewer_of;
+        if (c->resync && h && !h->decoder.get_values ().empty () && c->out.size () - c->sent <= MAX_BACKLOG)
+        {
+            auto &t = h->decoder.get_topology ();
+            auto &v = h->decoder.get_values ();
+            c->out.insert (c->out.end (), t.begin (), t.end ());
+            c->out.insert (c->out.end (), v.begin (), v.end ());
+            c->resync = false;
+        }
+        if (c->sent < c->out.size ())
+        {
+            const ssize_t n = send (c->fd, &c->out[c->sent], c->out.size () - c->sent, MSG_NOSIGNAL);
+            if (n == -1 && errno != EAGAIN && errno != EINTR)
+            {
+                close (c);
+                return;
+            }
+            if (n > 0)
+                c->sent += n;
+        }
+        if (c->sent == c->out.size ())
+        {
+            c->out.clear ();
+            c->sent = 0;
+        }
+        // wait for room in the socket buffer if anything is left
+        const bool waiting = !c->out.empty ();
+        if (waiting != c->waiting)
+        {
+            epoll_event e;
+            e.events = waiting ? EPOLLIN | EPOLLOUT : EPOLLIN;
+            e.data.ptr = c;
+            epoll_ctl (ep, EPOLL_CTL_MOD, c->fd, &e);
+            c->waiting = waiting;
+        }
+    }
+    public:
+    /// @brief constructor
+    ///
+    /// @param addrs addresses to listen on
+    /// @param dir directory to record snapshots in, or empty
+    collector (const vector<string> &addrs, const string &dir)
+        : ep (epoll_create1 (EPOLL_CLOEXEC))
+        , dir (dir)
+    {
+        if (ep == -1)
+            throw runtime_error ("could not create epoll descriptor");
+        for (auto &a : addrs)
+            add (listen_on (a), true);
+    }
+    /// @brief destructor
+    ~collector ()
+    {
+        for (auto &h : hosts)
+            write_record (h.second);
+        for (auto &c : connections)
+            if (c->fd != -1)
+                ::close (c->fd);
+        ::close (ep);
+    }
+    collector (const collector &) = delete;
+    collector &operator= (const collector &) = delete;
+    /// @brief handle events until stopped
+    void run ()
+    {
+        vector<epoll_event> events (1024);
+        uint64_t swept = now_ms ();
+        while (!done)
+        {
+            const int n = epoll_wait (ep, &events[0], events.size (), 1000);
+            if (n == -1 && errno != EINTR)
+                throw runtime_error ("epoll_wait failed");
+            for (int i = 0; i < n; ++i)
+            {
+                connection *c = static_cast<connection *> (events[i].data.ptr);
+                if (c->fd == -1)
+                    continue;
+                if (c->listener)
+                {
+                    accept (c);
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT)
+                    queue (c);
+                if (!(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                    continue;
+                // one read per event keeps a busy agent from starving the others
+                const ssize_t bytes = c->in.read (c->fd);
+                if (bytes == 0 || (bytes == -1 && errno != EAGAIN && errno != EINTR))
+                {
+                    close (c);
+                    continue;
+                }
+                try
+                {
+                    while (const wire_header *h = c->in.next ())
+                        handle (c, frame_view (h, h->size));
+                }
+                catch (const exception &e)
+                {
+                    clog << e.what () << endl;
+                    close (c);
+                }
+            }
+            // one write per connection per iteration
+            for (auto c : dirty)
+                flush (c);
+            dirty.clear ();
+            // write recordings that have waited long enough
+            const uint64_t now = now_ms ();
+            if (!dir.empty () && now - swept >= 1000)
+            {
+                for (auto &h : hosts)
+                    if (now - h.second.recorded >= RECORD_INTERVAL)
+                        write_record (h.second);
+                swept = now;
+            }
+            // free closed connections
+            if (!closed.empty ())
+            {
+                connections.erase (remove_if (connections.begin (), connections.end (),
+                    [] (const unique_ptr<connection> &c) { return c->fd == -1; }), connections.end ());
+                closed.clear ();
+            }
+        }
+    }
+    /// @brief get the number of hosts seen
+    ///
+    /// @return the number of hosts
+    size_t get_hosts () const
+    {
+        return hosts.size ();
+    }
+};
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        // parse the options
+        vector<string> listen;
+        string dir;
+        static struct option options[] =
+        {
+            {"help", 0, 0, 'h'},
+            {"listen", 1, 0, 'l'},
+            {"dir", 1, 0, 'd'},
+            {NULL, 0, NULL, 0}
+        };
+        int option_index;
+        int arg;
+        while ((arg = getopt_long (argc, argv, "hl:d:", options, &option_index)) != -1)
+        {
+            switch (arg)
+            {
+                default:
+                    throw runtime_error ("unknown option specified");
+                case 'h':
+                clog << usage << endl;
+                return 0;
+                case 'l':
+                listen.push_back (string (optarg));
+                break;
+                case 'd':
+                dir = string (optarg);
+                break;
+            }
+        };
+        if (listen.empty ())
+            listen.push_back (DEFAULT_COLLECTOR);
+
+        // print version info
+        clog << "therm version " << MAJOR_REVISION << '.' << MINOR_REVISION << endl;
+
+        // print the options
+        for (auto &l : listen)
+            clog << "listen=\"" << l << "\"" << endl;
+        clog << "dir=\"" << dir << "\"" << endl;
+
+        signal (SIGINT, stop);
+        signal (SIGTERM, stop);
+        signal (SIGHUP, stop);
+        signal (SIGPIPE, SIG_IGN);
+
+        // every agent and viewer needs a descriptor
+        rlimit r;
+        if (getrlimit (RLIMIT_NOFILE, &r) == 0 && r.rlim_cur < r.rlim_max)
+        {
+            r.rlim_cur = r.rlim_max;
+            setrlimit (RLIMIT_NOFILE, &r);
+        }
+
+        collector c (listen, dir);
+        c.run ();
+
+        clog << "hosts=" << c.get_hosts () << endl;
+        clog << "exiting" << endl;
+        return 0;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what () << endl;
+        return -1;
+    }
+}
@@ -0,0 +1,325 @@
+/// @file thermd.cc
+/// @brief sample sensors and publish the snapshots in shared memory
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "cpufreq.h"
+#include "net.h"
+#include "powercap.h"
+#include "shm.h"
+#include "wire.h"
+#include <fcntl.h>
+#include <getopt.h>
+#include <memory>
+#include <random>
+
+using namespace std;
+using namespace therm;
+
+const string usage = "usage: thermd [-i#|--interval=#] [-n '...'|--name='...'] [-o '...'|--output='...'] [-p '...'|--push='...'] [-m#|--simulate=#] [-?|--help]";
+
+volatile sig_atomic_t done = 0;
+
+void stop (int)
+{
+    done = 1;
+}
+
+/// @brief push snapshots to a collector
+///
+/// Only the values that changed are sent.  If the collector goes away,
+/// snapshots are dropped until it can be reached again, and then the
+/// topology and all values are sent.
+class pusher
+{
+    private:
+    string addr;
+    bool quiet;
+    wire_encoder encoder;
+    vector<char> buf;
+    int fd;
+    uint64_t retry;
+    unsigned backoff;
+    public:
+    /// @brief constructor
+    ///
+    /// @param addr collector address
+    /// @param host host name
+    /// @param quiet don't log connection failures
+    pusher (const string &addr, const string &host, bool quiet)
+        : addr (addr)
+        , quiet (quiet)
+        , encoder (host)
+        , fd (-1)
+        , retry (0)
+        , backoff (1000)
+    {
+    }
+    /// @brief destructor
+    ~pusher ()
+    {
+        if (fd != -1)
+            close (fd);
+    }
+    pusher (const pusher &) = delete;
+    pusher &operator= (const pusher &) = delete;
+    /// @brief push a snapshot
+    ///
+    /// @param b vector of bus sensor data
+    /// @param time sample time in ms since the epoch
+    void push (const busses &b, uint64_t time)
+    {
+        if (fd == -1)
+        {
+            if (time < retry)
+                return;
+            try
+            {
+                // a stalled collector must not stall the sampler
+                fd = connect_to (addr, 1000);
+                set_send_timeout (fd, 1000);
+                encoder.reset ();
+                backoff = 1000;
+            }
+            catch (const exception &e)
+            {
+                if (!quiet)
+                    clog << e.what () << endl;
+                retry = time + backoff;
+                backoff = min (backoff * 2, 60000u);
+                return;
+            }
+        }
+        buf.clear ();
+        encoder.encode_delta (b, time, buf);
+        if (!send_all (fd, &buf[0], buf.size ()))
+        {
+            if (!quiet)
+                clog << "lost connection to " << addr << endl;
+            close (fd);
+            fd = -1;
+            retry = time + backoff;
+        }
+    }
+};
+
+/// @brief a host with made up sensors
+///
+/// Temperatures and fan speeds take random walks, and most of them stay the
+/// same from one sample to the next, like real sensors.
+class simulated_host
+{
+    private:
+    busses b;
+    pusher p;
+    public:
+    /// @brief constructor
+    ///
+    /// @param addr collector address
+    /// @param host host name
+    /// @param g random number generator
+    simulated_host (const string &addr, const string &host, mt19937 &g)
+        : p (addr, host, true)
+    {
+        uniform_int_distribution<int> cores (2, 16);
+        bus isa { "ISA adapter", 0, vector<chip> (2) };
+        isa.chips[0].name = "coretemp-isa-0000";
+        isa.chips[0].temps.push_back (temperature { 45.0, 80.0, 100.0, "Package id 0" });
+        for (int i = cores (g); i > 0; --i)
+            isa.chips[0].temps.push_back (temperature { 45.0, 80.0, 100.0, "Core " + to_string (isa.chips[0].temps.size () - 1) });
+        isa.chips[1].name = "nct6775-isa-0290";
+        for (auto l : { "SYSTIN", "CPUTIN", "AUXTIN" })
+            isa.chips[1].temps.push_back (temperature { 35.0, 0.0, 0.0, l });
+        for (auto l : { "CPU Fan", "Chassis Fan", "Aux Fan" })
+            isa.chips[1].fan_speeds.push_back (fan_speed { 1200.0, l });
+        b.push_back (isa);
+    }
+    simulated_host (const simulated_host &) = delete;
+    simulated_host &operator= (const simulated_host &) = delete;
+    /// @brief take a sample and push it
+    ///
+    /// @param g random number generator
+    /// @param time sample time in ms since the epoch
+    void step (mt19937 &g, uint64_t time)
+    {
+        uniform_int_distribution<int> d (-10, 10);
+        for (auto &c : b[0].chips)
+        {
+            for (auto &t : c.temps)
+                if (abs (d (g)) > 8)
+                    t.current = max (20.0, min (105.0, t.current + (d (g) > 0 ? 1.0 : -1.0)));
+            for (auto &f : c.fan_speeds)
+                if (abs (d (g)) > 8)
+                    f.current = max (0.0, min (3000.0, f.current + d (g) * 5.0));
+        }
+        p.push (b, time);
+    }
+};
+
+/// @brief push made up snapshots of many hosts to a collector
+///
+/// @param addr collector address
+/// @param hosts number of hosts
+/// @param interval sample interval in ms
+void simulate (const string &addr, unsigned hosts, unsigned interval)
+{
+    mt19937 g;
+    vector<unique_ptr<simulated_host>> sims;
+    for (unsigned i = 0; i < hosts; ++i)
+        sims.emplace_back (new simulated_host (addr, "sim" + to_string (i), g));
+    while (!done)
+    {
+        const uint64_t time = now_ms ();
+        for (auto &s : sims)
+            s->step (g, time);
+        usleep (interval * 1000);
+    }
+}
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        // parse the options
+        unsigned interval = 1000;
+        string name = SHM_NAME;
+        string output;
+        string push;
+        unsigned simulated = 0;
+        static struct option options[] =
+        {
+            {"help", 0, 0, 'h'},
+            {"interval", 1, 0, 'i'},
+            {"name", 1, 0, 'n'},
+            {"output", 1, 0, 'o'},
+            {"push", 1, 0, 'p'},
+            {"simulate", 1, 0, 'm'},
+            {NULL, 0, NULL, 0}
+        };
+        int option_index;
+        int arg;
+        while ((arg = getopt_long (argc, argv, "hi:n:o:p:m:", options, &option_index)) != -1)
+        {
+            switch (arg)
+            {
+                default:
+                    throw runtime_error ("unknown option specified");
+                case 'h':
+                clog << usage << endl;
+                return 0;
+                case 'i':
+                interval = atoi (optarg);
+                break;
+                case 'n':
+                name = string (optarg);
+                break;
+                case 'o':
+                output = string (optarg);
+                break;
+                case 'p':
+                push = string (optarg);
+                break;
+                case 'm':
+                simulated = atoi (optarg);
+                break;
+            }
+        };
+        if (interval == 0)
+            throw runtime_error ("the interval must be greater than 0");
+        if (simulated && push.empty ())
+            throw runtime_error ("simulated hosts need a collector to push to");
+
+        // print version info
+        clog << "therm version " << MAJOR_REVISION << '.' << MINOR_REVISION << endl;
+
+        // print the options
+        clog << "interval=" << interval << endl;
+        clog << "name=\"" << name << "\"" << endl;
+        clog << "output=\"" << output << "\"" << endl;
+        clog << "push=\"" << push << "\"" << endl;
+        clog << "simulate=" << simulated << endl;
+
+        // remove the segment on the way out
+        signal (SIGINT, stop);
+        signal (SIGTERM, stop);
+        signal (SIGHUP, stop);
+
+        if (simulated)
+        {
+            simulate (push, simulated, interval);
+            clog << "exiting" << endl;
+            return 0;
+        }
+
+        // init the sensors library, the RAPL energy counters and the
+        // throttle counters
+        sensors s;
+        powercap rapl;
+        cpufreq freq;
+        clog << "libsensors version " << s.get_version () << endl;
+
+        // also write the snapshots to a file or pipe
+        int fd = -1;
+        if (output == "-")
+            fd = STDOUT_FILENO;
+        else if (!output.empty ())
+        {
+            fd = open (output.c_str (), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (fd == -1)
+                throw runtime_error ("could not open " + output);
+        }
+        wire_encoder encoder (get_host_name ());
+        vector<char> buf;
+
+        // and push them to a collector
+        unique_ptr<pusher> pushed;
+        if (!push.empty ())
+            pushed.reset (new pusher (push, get_host_name (), false));
+
+        shm_publisher p (name, interval);
+        busses b;
+        while (!done)
+        {
+            scan (s, b);
+            rapl.scan (b);
+            freq.scan (b);
+            p.publish (b);
+            const uint64_t time = now_ms ();
+            if (pushed)
+                pushed->push (b, time);
+            if (fd != -1)
+            {
+                buf.clear ();
+                encoder.encode (b, time, buf);
+                if (write (fd, &buf[0], buf.size ()) != ssize_t (buf.size ()))
+                    throw runtime_error ("could not write to " + output);
+            }
+            usleep (interval * 1000);
+        }
+        if (fd != -1 && fd != STDOUT_FILENO)
+            close (fd);
+
+        clog << "exiting" << endl;
+        return 0;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what () << endl;
+        return -1;
+    }
+}
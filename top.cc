@@ -0,0 +1,373 @@
+/// @file top.cc
+/// @brief processes and cgroups that use the most cpu
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "top.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <cerrno>
+#include <iomanip>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace therm
+{
+
+std::ostream& operator<< (std::ostream &s, const consumer &c)
+{
+    s << std::fixed << std::setprecision (1) << std::setw (6) << c.cpu << "% ";
+    s.unsetf (std::ios_base::floatfield);
+    if (c.pid)
+        s << std::setw (7) << c.pid << ' ';
+    return s << c.name;
+}
+
+/// @brief get the monotonic time
+///
+/// @return the time in ns
+static uint64_t now_ns ()
+{
+    timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return uint64_t (ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/// @brief read a process's command and cpu time from its stat file
+///
+/// @param fd stat file
+/// @param comm the command
+/// @param ticks user plus system time
+///
+/// @return false if the process went away
+static bool read_stat (int fd, char (&comm)[16], uint64_t &ticks)
+{
+    char buf[1024];
+    const ssize_t n = pread (fd, buf, sizeof (buf) - 1, 0);
+    if (n <= 0)
+        return false;
+    buf[n] = 0;
+    // the command is in parentheses, and may have parentheses itself
+    const char *open = strchr (buf, '(');
+    const char *close = strrchr (buf, ')');
+    if (open == nullptr || close == nullptr || close < open)
+        return false;
+    const size_t len = std::min (size_t (close - open - 1), sizeof (comm) - 1);
+    memcpy (comm, open + 1, len);
+    comm[len] = 0;
+    // skip the state and the next 10 fields to get to utime and stime
+    const char *p = close + 1;
+    for (int i = 0; i < 11 && p; ++i)
+        p = strchr (p + 1, ' ');
+    if (p == nullptr)
+        return false;
+    char *end;
+    const uint64_t utime = strtoull (p, &end, 10);
+    const uint64_t stime = strtoull (end, &end, 10);
+    ticks = utime + stime;
+    return true;
+}
+
+/// @brief read a cgroup's cpu time
+///
+/// @param fd cpu.stat or cpuacct.usage file
+/// @param usage the time
+///
+/// @return false if the cgroup went away
+static bool read_usage (int fd, uint64_t &usage)
+{
+    char buf[256];
+    const ssize_t n = pread (fd, buf, sizeof (buf) - 1, 0);
+    if (n <= 0)
+        return false;
+    buf[n] = 0;
+    // cpu.stat starts with 'usage_usec', cpuacct.usage is just the number
+    const char *p = strncmp (buf, "usage_usec ", 11) == 0 ? buf + 11 : buf;
+    char *end;
+    usage = strtoull (p, &end, 10);
+    return end != p;
+}
+
+top_consumers::top_consumers (size_t n, const std::string &proc_dir, const std::string &cgroup_dir)
+    : n (n)
+    , proc_dir (proc_dir)
+    , proc (opendir (proc_dir.c_str ()))
+    , open_fds (0)
+    , max_fds (0)
+    , samples (0)
+    , time (now_ns ())
+    , ticks_per_second (sysconf (_SC_CLK_TCK))
+{
+    // cgroup v2 has one tree, v1 has one for cpu accounting
+    struct stat s;
+    if (stat ((cgroup_dir + "/cgroup.controllers").c_str (), &s) == 0)
+    {
+        cgroup_root = cgroup_dir;
+        usage_file = "cpu.stat";
+        usage_scale = 1;
+    }
+    else
+    {
+        cgroup_root = cgroup_dir + "/cpuacct";
+        usage_file = "cpuacct.usage";
+        usage_scale = 1000;
+    }
+    // leave the other half for everything else
+    rlimit r;
+    if (getrlimit (RLIMIT_NOFILE, &r) == 0)
+        max_fds = r.rlim_cur == RLIM_INFINITY ? 1 << 20 : r.rlim_cur / 2;
+    best_procs.reserve (n + 1);
+    best_groups.reserve (n + 1);
+    processes.reserve (n);
+    cgroups.reserve (n);
+    // the first deltas are relative to this
+    ++samples;
+    sample_processes (0);
+    sample_cgroups (0);
+    processes.clear ();
+    cgroups.clear ();
+}
+
+top_consumers::~top_consumers ()
+{
+    if (proc)
+        closedir (proc);
+    for (auto &p : procs)
+        close_file (p.second.fd);
+    for (auto &g : groups)
+        close_file (g.second.fd);
+}
+
+bool top_consumers::open_file (const char *path, int &fd)
+{
+    fd = -1;
+    if (open_fds >= max_fds)
+        return true;
+    fd = open (path, O_RDONLY | O_CLOEXEC);
+    if (fd != -1)
+        ++open_fds;
+    // out of descriptors, so open it on every sample
+    return fd != -1 || errno == EMFILE || errno == ENFILE;
+}
+
+void top_consumers::close_file (int fd)
+{
+    if (fd == -1)
+        return;
+    close (fd);
+    --open_fds;
+}
+
+bool top_consumers::read_process (process &p, uint64_t &ticks) const
+{
+    if (p.fd != -1)
+        return read_stat (p.fd, p.comm, ticks);
+    char path[256];
+    snprintf (path, sizeof (path), "%s/%d/stat", proc_dir.c_str (), p.pid);
+    const int fd = open (path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+    const bool ok = read_stat (fd, p.comm, ticks);
+    close (fd);
+    return ok;
+}
+
+bool top_consumers::read_cgroup (const cgroup &g, uint64_t &usage) const
+{
+    if (g.fd != -1)
+        return read_usage (g.fd, usage);
+    const int fd = open ((cgroup_root + "/" + *g.name + "/" + usage_file).c_str (), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+    const bool ok = read_usage (fd, usage);
+    close (fd);
+    return ok;
+}
+
+void top_consumers::sample ()
+{
+    const uint64_t t = now_ns ();
+    const double dt = (t - time) / 1e9;
+    time = t;
+    ++samples;
+    sample_processes (dt);
+    sample_cgroups (dt);
+}
+
+uint64_t top_consumers::get_age () const
+{
+    return (now_ns () - time) / 1000000;
+}
+
+template<typename T>
+void top_consumers::keep (const T *x, std::vector<const T *> &best) const
+{
+    if (x->cpu <= 0 || (best.size () == n && x->cpu <= best.back ()->cpu))
+        return;
+    // insert it in order, dropping the least if there are too many
+    size_t i = best.size ();
+    best.push_back (x);
+    for (; i > 0 && best[i - 1]->cpu < x->cpu; --i)
+        best[i] = best[i - 1];
+    best[i] = x;
+    if (best.size () > n)
+        best.pop_back ();
+}
+
+void top_consumers::sample_processes (double dt)
+{
+    if (proc == nullptr || n == 0)
+        return;
+    best_procs.clear ();
+    rewinddir (proc);
+    while (dirent *e = readdir (proc))
+    {
+        if (!isdigit (e->d_name[0]))
+            continue;
+        const int pid = atoi (e->d_name);
+        auto i = procs.find (pid);
+        const bool found = i != procs.end ();
+        if (!found)
+        {
+            char path[256];
+            snprintf (path, sizeof (path), "%s/%d/stat", proc_dir.c_str (), pid);
+            int fd;
+            if (!open_file (path, fd))
+                continue;
+            process p;
+            p.pid = pid;
+            p.fd = fd;
+            p.seen = p.ticks = 0;
+            p.cpu = 0;
+            p.comm[0] = 0;
+            i = procs.insert (std::make_pair (pid, p)).first;
+        }
+        process &p = i->second;
+        uint64_t ticks;
+        if (!read_process (p, ticks))
+            continue;
+        p.seen = samples;
+        p.cpu = found && dt > 0 && ticks >= p.ticks ? (ticks - p.ticks) * 100.0 / ticks_per_second / dt : 0;
+        p.ticks = ticks;
+        keep (&p, best_procs);
+    }
+    processes.resize (best_procs.size ());
+    for (size_t k = 0; k < best_procs.size (); ++k)
+    {
+        const process &p = *best_procs[k];
+        processes[k].pid = p.pid;
+        processes[k].name.assign (p.comm);
+        processes[k].cpu = p.cpu;
+    }
+    // forget the processes that went away
+    for (auto i = procs.begin (); i != procs.end (); )
+    {
+        if (i->second.seen == samples)
+        {
+            ++i;
+            continue;
+        }
+        close_file (i->second.fd);
+        i = procs.erase (i);
+    }
+}
+
+void top_consumers::find_cgroups (const std::string &dir, const std::string &name)
+{
+    DIR *d = opendir (dir.c_str ());
+    if (d == nullptr)
+        return;
+    bool leaf = true;
+    while (dirent *e = readdir (d))
+    {
+        if (e->d_type != DT_DIR || e->d_name[0] == '.')
+            continue;
+        leaf = false;
+        find_cgroups (dir + "/" + e->d_name, name.empty () ? e->d_name : name + "/" + e->d_name);
+    }
+    closedir (d);
+    // the usage of a cgroup includes its children's
+    if (!leaf || name.empty ())
+        return;
+    auto i = groups.find (name);
+    if (i == groups.end ())
+    {
+        int fd;
+        if (!open_file ((dir + "/" + usage_file).c_str (), fd))
+            return;
+        cgroup g;
+        g.fd = fd;
+        g.usage = 0;
+        g.cpu = 0;
+        i = groups.insert (std::make_pair (name, g)).first;
+        i->second.name = &i->first;
+        // the first delta is relative to this
+        read_cgroup (i->second, i->second.usage);
+    }
+    i->second.seen = true;
+}
+
+void top_consumers::sample_cgroups (double dt)
+{
+    if (n == 0)
+        return;
+    // look for new cgroups, and forget the ones that went away
+    if ((samples - 1) % CGROUP_RESCAN == 0)
+    {
+        for (auto &g : groups)
+            g.second.seen = false;
+        find_cgroups (cgroup_root, std::string ());
+        for (auto i = groups.begin (); i != groups.end (); )
+        {
+            if (i->second.seen)
+            {
+                ++i;
+                continue;
+            }
+            close_file (i->second.fd);
+            i = groups.erase (i);
+        }
+    }
+    best_groups.clear ();
+    for (auto &x : groups)
+    {
+        cgroup &g = x.second;
+        uint64_t usage;
+        if (!read_cgroup (g, usage))
+            continue;
+        g.cpu = dt > 0 && usage >= g.usage ? (usage - g.usage) / usage_scale * 100.0 / 1e6 / dt : 0;
+        g.usage = usage;
+        keep (&g, best_groups);
+    }
+    cgroups.resize (best_groups.size ());
+    for (size_t k = 0; k < best_groups.size (); ++k)
+    {
+        cgroups[k].pid = 0;
+        cgroups[k].name.assign (*best_groups[k]->name);
+        cgroups[k].cpu = best_groups[k]->cpu;
+    }
+}
+
+} // namespace therm
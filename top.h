@@ -0,0 +1,198 @@
+/// @file top.h
+/// @brief processes and cgroups that use the most cpu
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef TOP_H
+#define TOP_H
+
+#include <cstdint>
+#include <dirent.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief default proc directory
+const char *const PROC_DIR = "/proc";
+
+/// @brief default cgroup directory
+const char *const CGROUP_DIR = "/sys/fs/cgroup";
+
+/// @brief the cgroup tree is walked again after this many samples
+const unsigned CGROUP_RESCAN = 10;
+
+/// @brief a process or cgroup and its cpu use
+struct consumer
+{
+    /// @brief process id, or 0 for a cgroup
+    int pid;
+    /// @brief process command or cgroup path
+    std::string name;
+    /// @brief percent of one cpu since the previous sample
+    double cpu;
+};
+
+/// @brief print a consumer
+///
+/// @param s stream
+/// @param c consumer
+///
+/// @return the stream
+std::ostream& operator<< (std::ostream &s, const consumer &c);
+
+/// @brief the processes and cgroups that used the most cpu since the
+/// previous sample
+///
+/// Each process's /proc/[pid]/stat and each leaf cgroup's cpu.stat, or
+/// cpuacct.usage with cgroup v1, is opened once and read again with pread
+/// on every sample, so once the processes are known, sampling doesn't
+/// allocate.  At most half of the descriptors the process may open are kept
+/// that way, and the files of the rest are opened on every sample.  /proc
+/// is listed on every sample to find new processes, and the cgroup tree
+/// every CGROUP_RESCAN samples.  A process shows up from its second sample
+/// on.
+class top_consumers
+{
+    public:
+    /// @brief constructor
+    ///
+    /// @param n how many of each to keep
+    /// @param proc_dir proc directory
+    /// @param cgroup_dir cgroup directory
+    top_consumers (size_t n, const std::string &proc_dir = PROC_DIR, const std::string &cgroup_dir = CGROUP_DIR);
+    /// @brief destructor
+    ~top_consumers ();
+    top_consumers (const top_consumers &) = delete;
+    top_consumers &operator= (const top_consumers &) = delete;
+    /// @brief get how many of each are kept
+    ///
+    /// @return the number
+    size_t size () const { return n; }
+    /// @brief take a sample
+    void sample ();
+    /// @brief get the time since the previous sample
+    ///
+    /// @return the time in ms
+    uint64_t get_age () const;
+    /// @brief get the processes that used the most cpu, most first
+    ///
+    /// @return the processes
+    const std::vector<consumer> &get_processes () const { return processes; }
+    /// @brief get the cgroups that used the most cpu, most first
+    ///
+    /// @return the cgroups
+    const std::vector<consumer> &get_cgroups () const { return cgroups; }
+    private:
+    struct process
+    {
+        int pid;
+        int fd;
+        /// @brief sample in which it was last seen
+        uint64_t seen;
+        /// @brief user plus system time, in clock ticks
+        uint64_t ticks;
+        double cpu;
+        /// @brief command, as in /proc/[pid]/comm
+        char comm[16];
+    };
+    struct cgroup
+    {
+        /// @brief its key in groups
+        const std::string *name;
+        int fd;
+        bool seen;
+        /// @brief cpu time, in the units of the file
+        uint64_t usage;
+        double cpu;
+    };
+    /// @brief open a file that is read on every sample
+    ///
+    /// @param path the file
+    /// @param fd its descriptor, or -1 if it should be opened on every
+    /// sample instead, because too many are open
+    ///
+    /// @return false if it doesn't exist
+    bool open_file (const char *path, int &fd);
+    /// @brief close a file opened by open_file ()
+    ///
+    /// @param fd its descriptor, or -1
+    void close_file (int fd);
+    /// @brief read a process's command and cpu time
+    ///
+    /// @param p the process
+    /// @param ticks user plus system time
+    ///
+    /// @return false if the process went away
+    bool read_process (process &p, uint64_t &ticks) const;
+    /// @brief read a cgroup's cpu time
+    ///
+    /// @param g the cgroup
+    /// @param usage the time
+    ///
+    /// @return false if the cgroup went away
+    bool read_cgroup (const cgroup &g, uint64_t &usage) const;
+    /// @brief sample the processes
+    ///
+    /// @param dt seconds since the previous sample
+    void sample_processes (double dt);
+    /// @brief sample the cgroups
+    ///
+    /// @param dt seconds since the previous sample
+    void sample_cgroups (double dt);
+    /// @brief find the leaf cgroups
+    ///
+    /// @param dir directory to search
+    /// @param name its path relative to the cgroup root
+    void find_cgroups (const std::string &dir, const std::string &name);
+    /// @brief keep the consumers that used the most cpu
+    ///
+    /// @tparam T process or cgroup
+    /// @param x candidate
+    /// @param best the most so far, most first
+    template<typename T>
+    void keep (const T *x, std::vector<const T *> &best) const;
+    size_t n;
+    std::string proc_dir;
+    std::string cgroup_root;
+    /// @brief cgroup usage file and its units per us
+    std::string usage_file;
+    double usage_scale;
+    DIR *proc;
+    /// @brief descriptors kept open, and how many may be
+    size_t open_fds;
+    size_t max_fds;
+    std::unordered_map<int, process> procs;
+    std::map<std::string, cgroup> groups;
+    uint64_t samples;
+    uint64_t time;
+    long ticks_per_second;
+    std::vector<const process *> best_procs;
+    std::vector<const cgroup *> best_groups;
+    std::vector<consumer> processes;
+    std::vector<consumer> cgroups;
+};
+
+} // namespace therm
+
+#endif
@@ -21,8 +21,14 @@
 #ifndef UI_H
 #define UI_H
 
+#include "fans.h"
 #include "options.h"
+#include "peers.h"
+#include "shm.h"
+#include "top.h"
+#include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <cmath>
 #include <iostream>
 #include <ncurses.h>
@@ -63,6 +69,69 @@ class ncurses_ui
     bool done;
     /// @brief flag for debugging
     bool debug;
+    /// @brief temperatures that stand out from their peers
+    peer_analysis peers;
+    /// @brief learned fan speeds, and when they were last saved
+    fan_model fans;
+    uint64_t fans_saved;
+    /// @brief why the fan model couldn't be written, logged at exit
+    std::string fans_error;
+    /// @brief kinds of rows
+    enum line_type
+    {
+        BUS_LINE,
+        CHIP_LINE,
+        TEMP_LINE,
+        FAN_HEADER_LINE,
+        FAN_LINE,
+        MEASUREMENT_LINE,
+        BLANK_LINE
+    };
+    /// @brief a row of the layout
+    struct line
+    {
+        int type;
+        uint32_t bus;
+        uint32_t chip;
+        /// @brief index of the temperature or fan on its chip, or of the
+        /// first of the row's readings in the measurement list
+        uint32_t index;
+        /// @brief number of readings on a measurement row, or the number
+        /// shown in front of a temperature or fan
+        uint32_t n;
+        /// @brief index of the temperature among all temperatures, or of
+        /// the fan among all fans
+        uint32_t peer;
+        /// @brief the frequency and throttle count beside a temperature,
+        /// or -1
+        int freq;
+        int throttle;
+        /// @brief columns beside the temperature bars of the chip
+        int side;
+    };
+    /// @brief the rows of the sensor list, and the sizes of the topology
+    /// they were laid out for
+    std::vector<line> layout;
+    std::vector<uint32_t> shape;
+    /// @brief the sizes of the latest topology, kept so each frame reuses
+    /// its storage
+    std::vector<uint32_t> sizes;
+    /// @brief the readings of the measurement rows
+    std::vector<uint32_t> measurement_list;
+    /// @brief true if the layout has to be rebuilt
+    bool dirty;
+    /// @brief the first row in view, and the number of rows in view
+    int first;
+    int height;
+    /// @brief width of the cpu number column
+    int indent1;
+    /// @brief column after the labels on the bottom row
+    int status_col;
+    /// @brief only show chips and sensors whose names contain this
+    std::string filter;
+    bool editing;
+    /// @brief columns for each power, voltage, current or energy reading
+    static const int MEASUREMENT_WIDTH = 24;
     static const int WHITE = COLOR_PAIR(1);
     static const int GREEN = COLOR_PAIR(2);
     static const int YELLOW = COLOR_PAIR(3);
@@ -70,12 +139,24 @@ class ncurses_ui
     static const int BLUE = COLOR_PAIR(5);
     static const int GRAY_ON_CYAN = COLOR_PAIR(6);
     static const int RED_ON_CYAN = COLOR_PAIR(7);
+    static const int CYAN = COLOR_PAIR(8);
     public:
     /// @brief constructor
-    ncurses_ui (options &opts)
+    ///
+    /// @param opts configuration options
+    /// @param fans_fn fan model filename, or empty to not keep it
+    ncurses_ui (options &opts, const std::string &fans_fn)
         : opts (opts)
         , done (false)
         , debug (false)
+        , fans (fans_fn)
+        , fans_saved (now_ms ())
+        , dirty (true)
+        , first (0)
+        , height (1)
+        , indent1 (2)
+        , status_col (0)
+        , editing (false)
     {
         init ();
         labels ();
@@ -84,6 +165,9 @@ class ncurses_ui
     ~ncurses_ui ()
     {
         release ();
+        save_fans ();
+        if (!fans_error.empty ())
+            std::clog << fans_error << std::endl;
     }
     /// @brief initialize ncurses stuff
     void init ()
@@ -97,6 +181,7 @@ class ncurses_ui
         curs_set (0); // make cursor invisible
         erase ();
         getmaxyx (stdscr, rows, cols);
+        dirty = true;
         init_pair (1, COLOR_WHITE, -1);
         init_pair (2, COLOR_GREEN, -1);
         init_pair (3, COLOR_YELLOW, -1);
@@ -104,6 +189,7 @@ class ncurses_ui
         init_pair (5, COLOR_BLUE, -1);
         init_pair (6, COLOR_WHITE, COLOR_CYAN);
         init_pair (7, COLOR_RED, COLOR_CYAN);
+        init_pair (8, COLOR_CYAN, -1);
         timeout (1000); // timeout in ms
     }
     /// @brief ncurses cleanup
@@ -121,10 +207,39 @@ class ncurses_ui
     /// @brief event loop support
     void process (int ch, const std::string &config_fn)
     {
+        if (editing)
+        {
+            edit_filter (ch);
+            ch = ERR;
+        }
         switch (ch)
         {
             default:
             break;
+            case KEY_UP:
+            --first;
+            break;
+            case KEY_DOWN:
+            ++first;
+            break;
+            case KEY_PPAGE:
+            first -= height;
+            break;
+            case KEY_NPAGE:
+            first += height;
+            break;
+            case KEY_HOME:
+            first = 0;
+            break;
+            case KEY_END:
+            first = layout.size ();
+            break;
+            case '/':
+            editing = true;
+            filter.clear ();
+            first = 0;
+            dirty = true;
+            break;
             case 'q':
             case 'Q':
             done = true;
@@ -157,77 +272,334 @@ class ncurses_ui
     }
     /// @brief display temps
     ///
+    /// Only the rows in view are drawn, from a layout that is rebuilt when
+    /// the topology, the screen size or the filter changes.
+    ///
     /// @param busses vector of busses
-    void show_temps (const busses &bs) const
+    /// @param reserved rows to leave below them
+    ///
+    /// @return the row below them
+    int show_temps (const busses &bs, int reserved = 0)
     {
+        peers.update (bs);
+        fans.update (bs);
+        // keep what was learned if therm is killed
+        if (now_ms () - fans_saved > FAN_SAVE_INTERVAL)
+            save_fans ();
+        update_layout (bs);
+        height = std::max (1, rows - 1 - reserved);
+        // keep the view on the layout
+        first = std::max (0, std::min (first, int (layout.size ()) - height));
+        int row = 0;
+        for (size_t i = first; i < layout.size () && row < height; ++i, ++row)
+        {
+            move (row, 0);
+            clrtoeol ();
+            show_line (bs, layout[i], row);
+        }
+        for (int r = row; r < height; ++r)
+        {
+            move (r, 0);
+            clrtoeol ();
+        }
+        show_status ();
+        return row;
+    }
+    /// @brief display the processes and cgroups that use the most cpu
+    ///
+    /// @param t the processes and cgroups
+    /// @param row the first row
+    void show_top (const top_consumers &t, int row) const
+    {
+        // processes on the left and cgroups on the right
+        const int width = cols / 2;
+        text ({WHITE}, rows, row, 0, "%-*s", width, "  PROCESSES");
+        text ({WHITE}, rows, row++, width, "%-*s", cols - width, "  CGROUPS");
+        const auto &ps = t.get_processes ();
+        const auto &gs = t.get_cgroups ();
+        for (size_t k = 0; k < t.size (); ++k, ++row)
+        {
+            std::stringstream ss;
+            if (k < ps.size ())
+                ss << ps[k];
+            text ({A_BOLD, ps.size () > k && ps[k].cpu >= 50 ? YELLOW : WHITE}, rows, row, 0, "%-*.*s", width, width, ss.str ().c_str ());
+            ss.str ("");
+            if (k < gs.size ())
+                ss << gs[k];
+            text ({A_BOLD, gs.size () > k && gs[k].cpu >= 50 ? YELLOW : WHITE}, rows, row, width, "%-*.*s", cols - width, cols - width, ss.str ().c_str ());
+        }
+    }
+    private:
+    /// @brief check if a name matches the filter
+    ///
+    /// @param name the name
+    ///
+    /// @return true if it contains the filter, ignoring case
+    bool matches (const std::string &name) const
+    {
+        auto i = std::search (name.begin (), name.end (), filter.begin (), filter.end (), [] (char a, char b)
+        {
+            return tolower (a) == tolower (b);
+        });
+        return i != name.end () || filter.empty ();
+    }
+    /// @brief rebuild the layout if the topology, the screen size or the
+    /// filter changed
+    ///
+    /// @param bs vector of bus sensor data
+    void update_layout (const busses &bs)
+    {
+        // the topology is compared by its sizes, which costs one comparison
+        // per chip
+        sizes.clear ();
+        for (auto &b : bs)
+        {
+            sizes.push_back (b.chips.size ());
+            for (auto &c : b.chips)
+            {
+                sizes.push_back (c.temps.size ());
+                sizes.push_back (c.fan_speeds.size ());
+                sizes.push_back (c.measurements.size ());
+            }
+        }
+        if (!dirty && sizes == shape)
+            return;
+        dirty = false;
+        shape.swap (sizes);
+        layout.clear ();
+        measurement_list.clear ();
         // get the width of the cpu number column
         size_t max_cpus = 0;
-        for (auto bus : bs)
-            for (auto chip : bus.chips)
-                if (chip.temps.size () > max_cpus)
-                    max_cpus = chip.temps.size ();
-        std::stringstream ss;
-        ss << max_cpus;
-        // length of largest number plus a space
-        const int indent1 = ss.str ().size () + 1;
-        // assumes temps are 3 digits at most, plus the C or F, plus a space
-        const int indent2 = indent1 + 5;
-        const int indent3 = indent2 + 7;
-        // print the temperatures
-        auto row = 0;
-        for (auto bus : bs)
+        for (auto &b : bs)
+            for (auto &c : b.chips)
+                max_cpus = std::max (max_cpus, c.temps.size ());
+        indent1 = std::to_string (max_cpus).size () + 1;
+        // print power, voltage, current and energy several to a row
+        const uint32_t per_row = std::max (1, (cols - 2) / MEASUREMENT_WIDTH);
+        uint32_t peer = 0;
+        uint32_t fan = 0;
+        for (uint32_t i = 0; i < bs.size (); ++i)
         {
-            text ({}, rows, row++, 0, "%s", bus.name.c_str ());
-            size_t chipno = 0;
-            for (auto chip : bus.chips)
+            const size_t bus_line = layout.size ();
+            layout.push_back (line { BUS_LINE, i, 0, 0, 0, 0, -1, -1, 0 });
+            for (uint32_t j = 0; j < bs[i].chips.size (); ++j)
             {
-                if (bus.chips.size () > 1)
-                    text ({}, rows, row++, 0, "%s %d", chip.name.c_str (), chipno++);
+                const chip &c = bs[i].chips[j];
+                const bool all = matches (c.name);
+                const size_t chip_line = layout.size ();
+                layout.push_back (line { CHIP_LINE, i, j, 0, 0, 0, -1, -1, 0 });
+                // frequencies and throttle events go beside the temperatures
+                bool beside = false;
+                for (auto &m : c.measurements)
+                    beside = beside || is_beside (c, m);
+                const int side = beside ? 18 : 0;
+                for (uint32_t k = 0; k < c.temps.size (); ++k, ++peer)
+                {
+                    if (!all && !matches (c.temps[k].label))
+                        continue;
+                    line l { TEMP_LINE, i, j, k, k, peer, -1, -1, side };
+                    for (uint32_t m = 0; m < c.measurements.size (); ++m)
+                    {
+                        if (c.measurements[m].label != c.temps[k].label)
+                            continue;
+                        if (c.measurements[m].kind == FREQUENCY)
+                            l.freq = m;
+                        else if (c.measurements[m].kind == THROTTLE)
+                            l.throttle = m;
+                    }
+                    layout.push_back (l);
+                }
+                bool header = false;
+                for (uint32_t k = 0; k < c.fan_speeds.size (); ++k, ++fan)
+                {
+                    if (!all && !matches (c.fan_speeds[k].label))
+                        continue;
+                    if (!header)
+                        layout.push_back (line { FAN_HEADER_LINE, i, j, 0, 0, 0, -1, -1, 0 });
+                    header = true;
+                    layout.push_back (line { FAN_LINE, i, j, k, k, fan, -1, -1, 0 });
+                }
+                const uint32_t begin = measurement_list.size ();
+                for (uint32_t k = 0; k < c.measurements.size (); ++k)
+                    if (!is_beside (c, c.measurements[k]) && (all || matches (c.measurements[k].label)))
+                        measurement_list.push_back (k);
+                for (uint32_t k = begin; k < measurement_list.size (); k += per_row)
+                {
+                    const uint32_t n = std::min<uint32_t> (per_row, measurement_list.size () - k);
+                    layout.push_back (line { MEASUREMENT_LINE, i, j, k, n, 0, -1, -1, 0 });
+                }
+                // drop chips that have nothing that matches
+                if (layout.size () == chip_line + 1 && !all)
+                    layout.pop_back ();
                 else
-                    text ({}, rows, row++, 0, "%s", chip.name.c_str ());
-                size_t n = 0;
-                for (auto t : chip.temps)
+                    layout.push_back (line { BLANK_LINE, i, j, 0, 0, 0, -1, -1, 0 });
+            }
+            if (layout.size () == bus_line + 1 && !matches (bs[i].name))
+                layout.pop_back ();
+        }
+    }
+    /// @brief draw a row of the layout
+    ///
+    /// @param bs vector of bus sensor data
+    /// @param l the row
+    /// @param row where to draw it
+    void show_line (const busses &bs, const line &l, int row)
+    {
+        const bus &b = bs[l.bus];
+        switch (l.type)
+        {
+            case BUS_LINE:
+            text ({}, rows, row, 0, "%s", b.name.c_str ());
+            break;
+            case CHIP_LINE:
+            if (b.chips.size () > 1)
+                text ({}, rows, row, 0, "%s %d", b.chips[l.chip].name.c_str (), l.chip);
+            else
+                text ({}, rows, row, 0, "%s", b.chips[l.chip].name.c_str ());
+            break;
+            case TEMP_LINE:
+            {
+                const chip &c = b.chips[l.chip];
+                temperature t = c.temps[l.index];
+                // set default temps if none were given
+                if (t.high == -1)
+                    t.high = 80;
+                if (t.critical == -1)
+                    t.critical = 90;
+                if (debug && !(rand () % c.temps.size ()))
+                    t.current = (rand () % int (t.critical + 10 - t.high)) + t.high;
+                // print the cpu number
+                text ({}, rows, row, 0, "%u", l.n);
+                // print the numerical value
+                char value[16];
+                snprintf (value, sizeof (value), "%.0f%c", round (opts.get_fahrenheit () ? ctof (t.current) : t.current), opts.get_fahrenheit () ? 'F' : 'C');
+                int color = GREEN;
+                if (t.current >= t.high)
+                    color = YELLOW;
+                if (t.current >= t.critical)
+                    color = RED;
+                // a temperature that stands out from its peers is reversed
+                if (peers.get_outliers ()[l.peer])
+                    text ({A_BOLD, A_REVERSE, color}, rows, row, indent1, "%4s", value);
+                else
+                    text ({A_BOLD, color}, rows, row, indent1, "%4s", value);
+                if (l.freq != -1)
+                    text ({A_BOLD, CYAN}, rows, row, cols - l.side + 1, "%7s", format (c.measurements[l.freq]).c_str ());
+                if (l.throttle != -1)
                 {
-                    // set default temps if none were given
-                    if (t.high == -1)
-                        t.high = 80;
-                    if (t.critical == -1)
-                        t.critical = 90;
-                    if (debug && !(rand () % chip.temps.size ()))
-                        t.current = (rand () % int (t.critical + 10 - t.high)) + t.high;
-                    // print the cpu number
-                    std::stringstream ss;
-                    ss << n++;
-                    text ({}, rows, row, 0, ss.str ().c_str ());
-                    // print the numerical value
-                    ss.str ("");
-                    ss << round (opts.get_fahrenheit () ? ctof (t.current) : t.current) << (opts.get_fahrenheit () ? 'F' : 'C');
-                    int color = GREEN;
-                    if (t.current >= t.high)
-                        color = YELLOW;
-                    if (t.current >= t.critical)
-                        color = RED;
-                    text ({A_BOLD, color}, rows, row, indent1, "%4s", ss.str ().c_str ());
-                    // print the bar
-                    const int size = cols - indent2;
-                    temp_bar (row++, indent2, size, t);
+                    const measurement &e = c.measurements[l.throttle];
+                    text ({A_BOLD, e.current > 0 ? RED : WHITE}, rows, row, cols - l.side + 9, "%5s thr", format (e).c_str ());
                 }
-                n = 0;
-                for (auto f : chip.fan_speeds)
+                // print the bar, after the number and its C or F
+                const int indent2 = indent1 + 5;
+                temp_bar (row, indent2, cols - indent2 - l.side, t);
+            }
+            break;
+            case FAN_HEADER_LINE:
+            text ({WHITE}, rows, row, 0, "  FAN");
+            break;
+            case FAN_LINE:
+            {
+                const fan_speed &f = b.chips[l.chip].fan_speeds[l.index];
+                // a fan that is stalled, or much slower or faster than
+                // usual, stands out
+                int color = WHITE;
+                switch (fans.get_health ()[l.peer])
                 {
-                    std::stringstream ss;
-                    ss << round (f.current);
-                    if (n == 0)
-                        text ({WHITE}, rows, row++, 0, "  FAN");
-                    text ({A_BOLD, WHITE}, rows, row, 0, "  %d %4s RPM", n++, ss.str ().c_str ());
-                    const int size = cols - indent3;
-                    speed_bar (row++, indent3, size, f);
+                    case HEALTH_STALLED: color = RED; break;
+                    case HEALTH_DEGRADED:
+                    case HEALTH_PINNED: color = YELLOW; break;
                 }
-                ++row;
+                text ({A_BOLD, color}, rows, row, 0, "  %u %4.0f RPM", l.n, round (f.current));
+                const int indent3 = indent1 + 12;
+                speed_bar (row, indent3, cols - indent3, f, fans.get_max ()[l.peer]);
+            }
+            break;
+            case MEASUREMENT_LINE:
+            for (uint32_t k = 0; k < l.n; ++k)
+            {
+                const measurement &m = b.chips[l.chip].measurements[measurement_list[l.index + k]];
+                text ({A_BOLD, CYAN}, rows, row, 2 + k * MEASUREMENT_WIDTH, "%7s", format (m).c_str ());
+                text ({WHITE}, rows, row, 10 + k * MEASUREMENT_WIDTH, "%.15s", m.label.c_str ());
             }
+            break;
+            case BLANK_LINE:
+            break;
         }
     }
-    private:
+    /// @brief show the filter and which rows are in view after the labels
+    void show_status () const
+    {
+        move (rows - 1, status_col);
+        clrtoeol ();
+        if (editing || !filter.empty ())
+            text ({A_BOLD}, rows + 1, rows - 1, status_col, "/%s%s", filter.c_str (), editing ? "_" : "");
+        if (!layout.empty () && (first > 0 || first + height < int (layout.size ())))
+        {
+            char view[32];
+            const int n = snprintf (view, sizeof (view), "%d-%d/%d", first + 1, std::min (first + height, int (layout.size ())), int (layout.size ()));
+            text ({A_BOLD, BLUE}, rows + 1, rows - 1, std::max (status_col, cols - n - 1), "%s", view);
+        }
+    }
+    /// @brief handle a key while the filter is being edited
+    ///
+    /// @param ch the key
+    void edit_filter (int ch)
+    {
+        switch (ch)
+        {
+            default:
+            // keys such as KEY_UP and KEY_RESIZE are above the range of
+            // isprint
+            if (ch >= 0 && ch < 256 && isprint (ch))
+                filter += char (ch);
+            else
+                return;
+            break;
+            case ERR:
+            case KEY_UP:
+            case KEY_DOWN:
+            case KEY_LEFT:
+            case KEY_RIGHT:
+            case KEY_PPAGE:
+            case KEY_NPAGE:
+            case KEY_HOME:
+            case KEY_END:
+            case KEY_RESIZE:
+            return;
+            case '\n':
+            case KEY_ENTER:
+            editing = false;
+            break;
+            case 27: // escape
+            editing = false;
+            filter.clear ();
+            break;
+            case KEY_BACKSPACE:
+            case 127:
+            case 8:
+            if (!filter.empty ())
+                filter.erase (filter.size () - 1);
+            break;
+        }
+        first = 0;
+        dirty = true;
+    }
+    /// @brief check if a reading is shown beside a temperature
+    ///
+    /// @param c the chip
+    /// @param m the reading
+    ///
+    /// @return true if it is a frequency or throttle count with a temperature's label
+    static bool is_beside (const chip &c, const measurement &m)
+    {
+        if (m.kind != FREQUENCY && m.kind != THROTTLE)
+            return false;
+        for (auto &t : c.temps)
+            if (t.label == m.label)
+                return true;
+        return false;
+    }
     /// @brief draw a temperature bar
     ///
     /// @tparam T temperature type
@@ -267,15 +639,16 @@ class ncurses_ui
     /// @param j col
     /// @param size bar length
     /// @param s speed
+    /// @param max the highest speed the fan has been seen at, or 0 if
+    /// unknown
     template<typename T>
-    void speed_bar (int i, int j, int size, T t) const
+    void speed_bar (int i, int j, int size, T t, double max) const
     {
         text ({A_BOLD}, rows, i, j, "[");
         text ({A_BOLD}, rows, i, j + size - 1, "]");
-        const int MIN = 20000;
-        const int MAX = 90000;
-        int current = t.current < MIN ? MIN : (t.current > MAX ? MAX : t.current);
-        int len = size * (current - MIN) / (MAX - MIN);
+        // until a fan's range is learned, a turning fan shows a full bar
+        const double MAX = std::max<double> (max, t.current);
+        const int len = MAX > 0 ? lround (size * std::max<double> (t.current, 0) / MAX) : 0;
         for (int k = 1; k + 1 < size; ++k)
         {
             int color = BLUE;
@@ -285,8 +658,23 @@ class ncurses_ui
                 text ({A_BOLD, color}, rows, i, j + k, "-");
         }
     }
+    /// @brief write the fan model, keeping the error if it can't be
+    /// written, since logging would draw over the screen
+    void save_fans ()
+    {
+        fans_saved = now_ms ();
+        try
+        {
+            fans.save ();
+            fans_error.clear ();
+        }
+        catch (const std::exception &e)
+        {
+            fans_error = e.what ();
+        }
+    }
     /// @brief draw labels
-    void labels () const
+    void labels ()
     {
         int col = 0;
         std::stringstream ss;
@@ -318,6 +706,14 @@ class ncurses_ui
         ss << "uit        ";
         text ({GRAY_ON_CYAN}, rows + 1, rows - 1, col, ss.str ().c_str ());
         col += ss.str ().size ();
+        ss.str ("");
+        ss << "/";
+        text ({}, rows + 1, rows - 1, col, ss.str ().c_str ());
+        col += ss.str ().size ();
+        ss.str ("");
+        ss << "Filter     ";
+        text ({GRAY_ON_CYAN}, rows + 1, rows - 1, col, ss.str ().c_str ());
+        col += ss.str ().size ();
         if (debug)
         {
             ss.str ("");
@@ -329,6 +725,7 @@ class ncurses_ui
             text ({RED_ON_CYAN}, rows + 1, rows - 1, col, ss.str ().c_str ());
             col += ss.str ().size ();
         }
+        status_col = col + 1;
     }
 };
 
@@ -338,9 +735,10 @@ class debug_ui
     private:
     options &opts;
     int done;
+    peer_analysis peers;
     public:
     /// @brief constructor
-    debug_ui (options &opts)
+    debug_ui (options &opts, const std::string &)
         : opts (opts)
         , done (0)
     {
@@ -369,8 +767,12 @@ class debug_ui
     /// @brief display temps
     ///
     /// @param busses vector of busses
-    void show_temps (const busses &bs) const
+    ///
+    /// @return the row below them
+    int show_temps (const busses &bs, int = 0)
     {
+        peers.update (bs);
+        size_t peer = 0;
         for (auto bus : bs)
         {
             std::clog << bus.name << std::endl;
@@ -382,10 +784,24 @@ class debug_ui
                     std::clog
                         << round (opts.get_fahrenheit () ? ctof (t.current) : t.current)
                         << (opts.get_fahrenheit () ? 'F' : 'C')
+                        << (peers.get_outliers ()[peer++] ? " outlier" : "")
                         << std::endl;
                 }
+                for (auto m : chip.measurements)
+                    std::clog << m.label << ' ' << format (m) << std::endl;
             }
         }
+        return 0;
+    }
+    /// @brief display the processes and cgroups that use the most cpu
+    ///
+    /// @param t the processes and cgroups
+    void show_top (const top_consumers &t, int) const
+    {
+        for (auto &c : t.get_processes ())
+            std::clog << c << std::endl;
+        for (auto &c : t.get_cgroups ())
+            std::clog << c << std::endl;
     }
 };
 
@@ -0,0 +1,565 @@
+/// @file wire.cc
+/// @brief flat binary snapshot format
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "wire.h"
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+
+namespace therm
+{
+
+/// @brief round a size up to the frame alignment
+///
+/// @param n the size
+///
+/// @return the aligned size
+static size_t align (size_t n)
+{
+    return (n + WIRE_ALIGNMENT - 1) & ~(WIRE_ALIGNMENT - 1);
+}
+
+/// @brief check that an array lies inside a frame
+///
+/// @param offset offset of the array
+/// @param n number of elements
+/// @param size size of an element
+/// @param frame_size size of the frame
+///
+/// @return true if it does
+static bool contains (uint64_t offset, uint64_t n, uint64_t size, uint64_t frame_size)
+{
+    return offset % sizeof (uint32_t) == 0 && offset + n * size <= frame_size;
+}
+
+/// @brief copy a string into a fixed size field
+///
+/// @param dst destination
+/// @param src source
+template<size_t N>
+static void copy_name (char (&dst)[N], const std::string &src)
+{
+    const size_t n = std::min (src.size (), N - 1);
+    memcpy (dst, src.c_str (), n);
+    memset (dst + n, 0, N - n);
+}
+
+/// @brief get a fixed size field as a string
+///
+/// @param src source
+///
+/// @return the string
+template<size_t N>
+static std::string get_name (const char (&src)[N])
+{
+    return std::string (src, strnlen (src, N));
+}
+
+frame_view::frame_view (const void *buf, size_t len)
+    : p (static_cast<const char *> (buf))
+    , valid (false)
+{
+    if (reinterpret_cast<uintptr_t> (p) % WIRE_ALIGNMENT != 0 || len < sizeof (wire_header))
+        return;
+    const wire_header &h = header ();
+    if (h.magic != WIRE_MAGIC || h.version != WIRE_VERSION || h.size > len || h.size % WIRE_ALIGNMENT != 0)
+        return;
+    if (h.type == WIRE_TOPOLOGY)
+    {
+        if (h.size < sizeof (wire_topology))
+            return;
+        const wire_topology &t = topology ();
+        if (!contains (t.bus_offset, t.busses, sizeof (wire_bus), h.size)
+            || !contains (t.chip_offset, t.chips, sizeof (wire_chip), h.size)
+            || !contains (t.limit_offset, t.temps, sizeof (wire_limits), h.size)
+            || !contains (t.label_offset, uint64_t (t.temps) + t.fans + t.measurements, sizeof (wire_label), h.size)
+            || !contains (t.kind_offset, t.measurements, sizeof (uint32_t), h.size))
+            return;
+        // readers index the arrays with these, so they must be in range
+        for (size_t i = 0; i < t.busses; ++i)
+            if (uint64_t (bus (i).first_chip) + bus (i).chips > t.chips)
+                return;
+        for (size_t i = 0; i < t.chips; ++i)
+            if (uint64_t (chip (i).first_temp) + chip (i).temps > t.temps
+                || uint64_t (chip (i).first_fan) + chip (i).fans > t.fans
+                || uint64_t (chip (i).first_measurement) + chip (i).measurements > t.measurements)
+                return;
+    }
+    else if (h.type == WIRE_VALUES)
+    {
+        if (h.size < sizeof (wire_values))
+            return;
+        const wire_values &v = values ();
+        if (!contains (v.temp_offset, v.temps, sizeof (float), h.size)
+            || !contains (v.fan_offset, v.fans, sizeof (float), h.size)
+            || !contains (v.measurement_offset, v.measurements, sizeof (float), h.size))
+            return;
+    }
+    else if (h.type == WIRE_DELTA)
+    {
+        if (h.size < sizeof (wire_delta))
+            return;
+        const wire_delta &d = delta ();
+        if (!contains (d.index_offset, d.count, sizeof (uint32_t), h.size)
+            || !contains (d.value_offset, d.count, sizeof (float), h.size))
+            return;
+    }
+    else if (h.type == WIRE_SUBSCRIBE)
+    {
+        if (h.size < sizeof (wire_subscribe))
+            return;
+    }
+    else
+        return;
+    valid = true;
+}
+
+std::string get_host_name ()
+{
+    char name[WIRE_HOST_SIZE];
+    if (gethostname (name, sizeof (name)) == -1)
+        return "unknown";
+    name[sizeof (name) - 1] = 0;
+    return name;
+}
+
+uint32_t encode_topology (const busses &bs, const std::string &host, std::vector<char> &buf)
+{
+    size_t nchips = 0, ntemps = 0, nfans = 0, nmeasurements = 0;
+    for (auto &b : bs)
+    {
+        nchips += b.chips.size ();
+        for (auto &c : b.chips)
+        {
+            ntemps += c.temps.size ();
+            nfans += c.fan_speeds.size ();
+            nmeasurements += c.measurements.size ();
+        }
+    }
+    const size_t bus_offset = sizeof (wire_topology);
+    const size_t chip_offset = bus_offset + bs.size () * sizeof (wire_bus);
+    const size_t limit_offset = chip_offset + nchips * sizeof (wire_chip);
+    const size_t label_offset = align (limit_offset + ntemps * sizeof (wire_limits));
+    const size_t kind_offset = label_offset + (ntemps + nfans + nmeasurements) * sizeof (wire_label);
+    const size_t size = align (kind_offset + nmeasurements * sizeof (uint32_t));
+    const size_t start = buf.size ();
+    buf.resize (start + size);
+    char *p = &buf[start];
+    memset (p, 0, size);
+    wire_topology &t = *reinterpret_cast<wire_topology *> (p);
+    t.header.magic = WIRE_MAGIC;
+    t.header.version = WIRE_VERSION;
+    t.header.type = WIRE_TOPOLOGY;
+    t.header.size = size;
+    copy_name (t.host, host);
+    t.busses = bs.size ();
+    t.chips = nchips;
+    t.temps = ntemps;
+    t.fans = nfans;
+    t.bus_offset = bus_offset;
+    t.chip_offset = chip_offset;
+    t.limit_offset = limit_offset;
+    t.label_offset = label_offset;
+    t.measurements = nmeasurements;
+    t.kind_offset = kind_offset;
+    wire_bus *wb = reinterpret_cast<wire_bus *> (p + bus_offset);
+    wire_chip *wc = reinterpret_cast<wire_chip *> (p + chip_offset);
+    wire_limits *wl = reinterpret_cast<wire_limits *> (p + limit_offset);
+    wire_label *temp_labels = reinterpret_cast<wire_label *> (p + label_offset);
+    wire_label *fan_labels = temp_labels + ntemps;
+    wire_label *measurement_labels = fan_labels + nfans;
+    uint32_t *kinds = reinterpret_cast<uint32_t *> (p + kind_offset);
+    size_t nchip = 0, ntemp = 0, nfan = 0, nmeasurement = 0;
+    for (auto &b : bs)
+    {
+        copy_name (wb->name, b.name);
+        wb->id = b.id;
+        wb->first_chip = nchip;
+        wb->chips = b.chips.size ();
+        ++wb;
+        for (auto &c : b.chips)
+        {
+            copy_name (wc->name, c.name);
+            wc->first_temp = ntemp;
+            wc->temps = c.temps.size ();
+            wc->first_fan = nfan;
+            wc->fans = c.fan_speeds.size ();
+            wc->first_measurement = nmeasurement;
+            wc->measurements = c.measurements.size ();
+            ++wc;
+            ++nchip;
+            for (auto &x : c.temps)
+            {
+                wl->high = x.high;
+                wl->critical = x.critical;
+                ++wl;
+                copy_name ((temp_labels++)->name, x.label);
+            }
+            for (auto &x : c.fan_speeds)
+                copy_name ((fan_labels++)->name, x.label);
+            for (auto &x : c.measurements)
+            {
+                copy_name ((measurement_labels++)->name, x.label);
+                *kinds++ = x.kind;
+            }
+            ntemp += c.temps.size ();
+            nfan += c.fan_speeds.size ();
+            nmeasurement += c.measurements.size ();
+        }
+    }
+    // FNV-1a over everything but the header
+    uint32_t id = 2166136261u;
+    for (size_t i = sizeof (wire_header); i < size; ++i)
+        id = (id ^ uint8_t (p[i])) * 16777619u;
+    t.header.topology_id = id;
+    return id;
+}
+
+void encode_values (const busses &bs, uint32_t topology_id, uint64_t time, std::vector<char> &buf)
+{
+    size_t ntemps = 0, nfans = 0, nmeasurements = 0;
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+        {
+            ntemps += c.temps.size ();
+            nfans += c.fan_speeds.size ();
+            nmeasurements += c.measurements.size ();
+        }
+    const size_t temp_offset = sizeof (wire_values);
+    const size_t fan_offset = temp_offset + ntemps * sizeof (float);
+    const size_t measurement_offset = fan_offset + nfans * sizeof (float);
+    const size_t size = align (measurement_offset + nmeasurements * sizeof (float));
+    const size_t start = buf.size ();
+    buf.resize (start + size);
+    char *p = &buf[start];
+    wire_values &v = *reinterpret_cast<wire_values *> (p);
+    v.header.magic = WIRE_MAGIC;
+    v.header.version = WIRE_VERSION;
+    v.header.type = WIRE_VALUES;
+    v.header.size = size;
+    v.header.topology_id = topology_id;
+    v.time = time;
+    v.temps = ntemps;
+    v.fans = nfans;
+    v.temp_offset = temp_offset;
+    v.fan_offset = fan_offset;
+    v.measurements = nmeasurements;
+    v.measurement_offset = measurement_offset;
+    float *t = reinterpret_cast<float *> (p + temp_offset);
+    float *f = reinterpret_cast<float *> (p + fan_offset);
+    float *m = reinterpret_cast<float *> (p + measurement_offset);
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+        {
+            for (auto &x : c.temps)
+                *t++ = x.current;
+            for (auto &x : c.fan_speeds)
+                *f++ = x.current;
+            for (auto &x : c.measurements)
+                *m++ = x.current;
+        }
+    // padding
+    memset (m, 0, p + size - reinterpret_cast<char *> (m));
+}
+
+void encode_subscribe (const std::string &host, std::vector<char> &buf)
+{
+    const size_t size = align (sizeof (wire_subscribe));
+    const size_t start = buf.size ();
+    buf.resize (start + size);
+    char *p = &buf[start];
+    memset (p, 0, size);
+    wire_subscribe &s = *reinterpret_cast<wire_subscribe *> (p);
+    s.header.magic = WIRE_MAGIC;
+    s.header.version = WIRE_VERSION;
+    s.header.type = WIRE_SUBSCRIBE;
+    s.header.size = size;
+    copy_name (s.host, host);
+}
+
+std::string get_host (const frame_view &f)
+{
+    return get_name (f.subscribe ().host);
+}
+
+/// @brief append a delta frame to a buffer
+///
+/// @param indices indices of the values that changed
+/// @param values all values
+/// @param topology_id topology id
+/// @param time sample time in ms since the epoch
+/// @param buf the buffer
+static void encode_delta (const std::vector<uint32_t> &indices, const std::vector<float> &values, uint32_t topology_id, uint64_t time, std::vector<char> &buf)
+{
+    const size_t index_offset = sizeof (wire_delta);
+    const size_t value_offset = index_offset + indices.size () * sizeof (uint32_t);
+    const size_t size = align (value_offset + indices.size () * sizeof (float));
+    const size_t start = buf.size ();
+    buf.resize (start + size);
+    char *p = &buf[start];
+    wire_delta &d = *reinterpret_cast<wire_delta *> (p);
+    d.header.magic = WIRE_MAGIC;
+    d.header.version = WIRE_VERSION;
+    d.header.type = WIRE_DELTA;
+    d.header.size = size;
+    d.header.topology_id = topology_id;
+    d.time = time;
+    d.count = indices.size ();
+    d.index_offset = index_offset;
+    d.value_offset = value_offset;
+    d.reserved = 0;
+    uint32_t *i = reinterpret_cast<uint32_t *> (p + index_offset);
+    float *v = reinterpret_cast<float *> (p + value_offset);
+    for (auto n : indices)
+    {
+        *i++ = n;
+        *v++ = values[n];
+    }
+    // padding
+    memset (v, 0, p + size - reinterpret_cast<char *> (v));
+}
+
+bool decode (const frame_view &t, const frame_view &v, busses &bs)
+{
+    if (!t.is_valid () || !v.is_valid ()
+        || t.type () != WIRE_TOPOLOGY || v.type () != WIRE_VALUES
+        || t.topology_id () != v.topology_id ()
+        || t.topology ().temps != v.values ().temps
+        || t.topology ().fans != v.values ().fans
+        || t.topology ().measurements != v.values ().measurements)
+        return false;
+    const wire_topology &wt = t.topology ();
+    const float *temps = v.temps ();
+    const float *fans = v.fans ();
+    const float *measurements = v.measurements ();
+    bs.resize (wt.busses);
+    for (size_t i = 0; i < wt.busses; ++i)
+    {
+        const wire_bus &wb = t.bus (i);
+        bus &b = bs[i];
+        b.name = get_name (wb.name);
+        b.id = wb.id;
+        b.chips.resize (wb.chips);
+        for (size_t j = 0; j < wb.chips; ++j)
+        {
+            const wire_chip &wc = t.chip (wb.first_chip + j);
+            chip &c = b.chips[j];
+            c.name = get_name (wc.name);
+            c.temps.resize (wc.temps);
+            for (size_t k = 0; k < wc.temps; ++k)
+            {
+                const wire_limits &l = t.limits (wc.first_temp + k);
+                temperature &x = c.temps[k];
+                x.current = temps[wc.first_temp + k];
+                x.high = l.high;
+                x.critical = l.critical;
+                x.label = get_name (t.label (wc.first_temp + k).name);
+            }
+            c.fan_speeds.resize (wc.fans);
+            for (size_t k = 0; k < wc.fans; ++k)
+            {
+                fan_speed &x = c.fan_speeds[k];
+                x.current = fans[wc.first_fan + k];
+                x.label = get_name (t.label (wt.temps + wc.first_fan + k).name);
+            }
+            c.measurements.resize (wc.measurements);
+            for (size_t k = 0; k < wc.measurements; ++k)
+            {
+                measurement &x = c.measurements[k];
+                x.kind = t.kind (wc.first_measurement + k);
+                x.current = measurements[wc.first_measurement + k];
+                x.label = get_name (t.label (wt.temps + wt.fans + wc.first_measurement + k).name);
+            }
+        }
+    }
+    return true;
+}
+
+wire_encoder::wire_encoder (const std::string &host)
+    : host (host)
+    , topology_id (0)
+{
+}
+
+bool wire_encoder::encode_topology (const busses &bs, std::vector<char> &buf)
+{
+    tmp.clear ();
+    const uint32_t id = therm::encode_topology (bs, host, tmp);
+    if (topology == tmp)
+        return false;
+    topology.swap (tmp);
+    topology_id = id;
+    buf.insert (buf.end (), topology.begin (), topology.end ());
+    return true;
+}
+
+void wire_encoder::encode (const busses &bs, uint64_t time, std::vector<char> &buf)
+{
+    encode_topology (bs, buf);
+    encode_values (bs, topology_id, time, buf);
+}
+
+void wire_encoder::encode_delta (const busses &bs, uint64_t time, std::vector<char> &buf)
+{
+    // values in wire order
+    current.clear ();
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+            for (auto &t : c.temps)
+                current.push_back (t.current);
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+            for (auto &f : c.fan_speeds)
+                current.push_back (f.current);
+    for (auto &b : bs)
+        for (auto &c : b.chips)
+            for (auto &m : c.measurements)
+                current.push_back (m.current);
+    if (encode_topology (bs, buf) || last.size () != current.size ())
+        encode_values (bs, topology_id, time, buf);
+    else
+    {
+        changed.clear ();
+        for (size_t i = 0; i < current.size (); ++i)
+            if (memcmp (&current[i], &last[i], sizeof (float)) != 0)
+                changed.push_back (i);
+        therm::encode_delta (changed, current, topology_id, time, buf);
+    }
+    last.swap (current);
+}
+
+void wire_encoder::reset ()
+{
+    topology.clear ();
+    last.clear ();
+}
+
+wire_decoder::wire_decoder ()
+    : time (0)
+{
+}
+
+bool wire_decoder::update (const frame_view &f)
+{
+    if (!f.is_valid ())
+        return false;
+    const char *p = reinterpret_cast<const char *> (&f.header ());
+    switch (f.type ())
+    {
+        default:
+        return false;
+        case WIRE_TOPOLOGY:
+        topology.assign (p, p + f.size ());
+        values.clear ();
+        return false;
+        case WIRE_VALUES:
+        if (topology.empty () || f.topology_id () != frame_view (&topology[0], topology.size ()).topology_id ())
+            return false;
+        values.assign (p, p + f.size ());
+        break;
+        case WIRE_DELTA:
+        {
+            if (values.empty () || f.topology_id () != frame_view (&values[0], values.size ()).topology_id ())
+                return false;
+            wire_values &v = *reinterpret_cast<wire_values *> (&values[0]);
+            float *temps = reinterpret_cast<float *> (&values[v.temp_offset]);
+            float *fans = reinterpret_cast<float *> (&values[v.fan_offset]);
+            float *measurements = reinterpret_cast<float *> (&values[v.measurement_offset]);
+            const uint32_t *indices = f.delta_indices ();
+            const float *changed = f.delta_values ();
+            for (size_t i = 0; i < f.delta ().count; ++i)
+            {
+                if (indices[i] < v.temps)
+                    temps[indices[i]] = changed[i];
+                else if (indices[i] - v.temps < v.fans)
+                    fans[indices[i] - v.temps] = changed[i];
+                else if (indices[i] - v.temps - v.fans < v.measurements)
+                    measurements[indices[i] - v.temps - v.fans] = changed[i];
+                else
+                    return false;
+            }
+            v.time = f.delta ().time;
+        }
+        break;
+    }
+    time = reinterpret_cast<const wire_values *> (&values[0])->time;
+    return true;
+}
+
+bool wire_decoder::decode (const frame_view &f, busses &bs)
+{
+    if (!update (f))
+        return false;
+    return therm::decode (frame_view (&topology[0], topology.size ()), frame_view (&values[0], values.size ()), bs);
+}
+
+std::string wire_decoder::get_host () const
+{
+    if (topology.empty ())
+        return std::string ();
+    return get_name (reinterpret_cast<const wire_topology *> (&topology[0])->host);
+}
+
+frame_reader::frame_reader ()
+    : buf (65536 / sizeof (uint64_t))
+    , begin (0)
+    , end (0)
+{
+}
+
+ssize_t frame_reader::read (int fd)
+{
+    const size_t capacity = buf.size () * sizeof (uint64_t);
+    char *p = reinterpret_cast<char *> (&buf[0]);
+    // move the partial frame to the front
+    if (begin != 0)
+    {
+        memmove (p, p + begin, end - begin);
+        end -= begin;
+        begin = 0;
+    }
+    // make room for a large frame
+    if (end == capacity)
+    {
+        buf.resize (buf.size () * 2);
+        return read (fd);
+    }
+    const ssize_t n = ::read (fd, p + end, capacity - end);
+    if (n > 0)
+        end += n;
+    return n;
+}
+
+const wire_header *frame_reader::next ()
+{
+    if (end - begin < sizeof (wire_header))
+        return nullptr;
+    const char *p = reinterpret_cast<const char *> (&buf[0]) + begin;
+    const wire_header *h = reinterpret_cast<const wire_header *> (p);
+    if (h->magic != WIRE_MAGIC || h->version != WIRE_VERSION
+        || h->size < sizeof (wire_header) || h->size > WIRE_MAX_FRAME || h->size % WIRE_ALIGNMENT)
+        throw std::runtime_error ("invalid frame in stream");
+    if (end - begin < h->size)
+        return nullptr;
+    begin += h->size;
+    return h;
+}
+
+} // namespace therm
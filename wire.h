@@ -0,0 +1,398 @@
+/// @file wire.h
+/// @brief flat binary snapshot format
+/// @author Jeff Perry <jeffsp@gmail.com>
+/// @date 2026-10-18
+
+// Copyright (C) 2013 Jeffrey S. Perry
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include "therm.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace therm
+{
+
+/// @brief wire format identification
+///
+/// Frames are in host byte order.  A reader on a host with the other byte
+/// order sees the magic number reversed and rejects the frame.
+const uint32_t WIRE_MAGIC = 0x54485257;
+const uint16_t WIRE_VERSION = 4;
+
+/// @brief frames start on, and are padded to, this many bytes
+const size_t WIRE_ALIGNMENT = 8;
+
+/// @brief largest frame accepted from a stream
+const size_t WIRE_MAX_FRAME = 16 << 20;
+
+/// @brief fixed name sizes
+const size_t WIRE_HOST_SIZE = 64;
+const size_t WIRE_NAME_SIZE = 48;
+const size_t WIRE_LABEL_SIZE = 32;
+
+/// @brief frame types
+enum wire_frame_type
+{
+    /// @brief names and limits, sent once and again when they change
+    WIRE_TOPOLOGY = 1,
+    /// @brief current values of every sensor in a topology
+    WIRE_VALUES = 2,
+    /// @brief values that changed since the previous values or delta frame
+    WIRE_DELTA = 3,
+    /// @brief ask a collector for the frames of one host
+    WIRE_SUBSCRIBE = 4
+};
+
+/// @brief common frame header
+struct wire_header
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;
+    /// @brief size of the frame in bytes, including the header and padding
+    uint32_t size;
+    /// @brief identifies the topology that the frame belongs to
+    uint32_t topology_id;
+};
+
+/// @brief topology frame header
+///
+/// The header is followed by the bus, chip, limit, label and kind arrays at
+/// the given offsets from the start of the frame.
+struct wire_topology
+{
+    wire_header header;
+    char host[WIRE_HOST_SIZE];
+    uint32_t busses;
+    uint32_t chips;
+    uint32_t temps;
+    uint32_t fans;
+    uint32_t bus_offset;
+    uint32_t chip_offset;
+    uint32_t limit_offset;
+    uint32_t label_offset;
+    uint32_t measurements;
+    uint32_t kind_offset;
+};
+
+/// @brief a bus in a topology frame
+struct wire_bus
+{
+    char name[WIRE_NAME_SIZE];
+    uint32_t id;
+    uint32_t first_chip;
+    uint32_t chips;
+    uint32_t reserved;
+};
+
+/// @brief a chip in a topology frame
+///
+/// Temperatures, fans and electrical readings of all chips are stored in one
+/// array each, in chip order.
+struct wire_chip
+{
+    char name[WIRE_NAME_SIZE];
+    uint32_t first_temp;
+    uint32_t temps;
+    uint32_t first_fan;
+    uint32_t fans;
+    uint32_t first_measurement;
+    uint32_t measurements;
+};
+
+/// @brief temperature limits in a topology frame
+struct wire_limits
+{
+    float high;
+    float critical;
+};
+
+/// @brief a sensor label in a topology frame
+///
+/// There is a label for every temperature, then every fan, and then every
+/// electrical reading.
+struct wire_label
+{
+    char name[WIRE_LABEL_SIZE];
+};
+
+/// @brief values frame header
+///
+/// The header is followed by the temperature, fan and electrical reading
+/// arrays at the given offsets from the start of the frame.
+struct wire_values
+{
+    wire_header header;
+    /// @brief sample time in ms since the epoch
+    uint64_t time;
+    uint32_t temps;
+    uint32_t fans;
+    uint32_t temp_offset;
+    uint32_t fan_offset;
+    uint32_t measurements;
+    uint32_t measurement_offset;
+};
+
+/// @brief delta frame header
+///
+/// The header is followed by the indices of the values that changed and
+/// their new values, at the given offsets from the start of the frame.  An
+/// index below the number of temperatures refers to a temperature, the next
+/// ones refer to fan speeds, and the rest to electrical readings.
+struct wire_delta
+{
+    wire_header header;
+    /// @brief sample time in ms since the epoch
+    uint64_t time;
+    uint32_t count;
+    uint32_t index_offset;
+    uint32_t value_offset;
+    uint32_t reserved;
+};
+
+/// @brief subscribe frame
+struct wire_subscribe
+{
+    wire_header header;
+    char host[WIRE_HOST_SIZE];
+};
+
+/// @brief read-only view of a frame in a byte buffer
+///
+/// Construction checks that the whole frame, including its arrays, lies
+/// inside the buffer.  After that fields are accessed in place.
+class frame_view
+{
+    public:
+    /// @brief constructor
+    ///
+    /// @param buf buffer that starts with a frame, aligned to WIRE_ALIGNMENT
+    /// @param len bytes in the buffer
+    frame_view (const void *buf, size_t len);
+    /// @brief check if the buffer holds a complete, valid frame
+    ///
+    /// @return true if it does
+    bool is_valid () const { return valid; }
+    /// @brief get the frame header
+    const wire_header &header () const { return *reinterpret_cast<const wire_header *> (p); }
+    /// @brief get the frame size
+    size_t size () const { return header ().size; }
+    /// @brief get the frame type
+    int type () const { return header ().type; }
+    /// @brief get the topology that the frame belongs to
+    uint32_t topology_id () const { return header ().topology_id; }
+    /// @brief get the topology header, if type () is WIRE_TOPOLOGY
+    const wire_topology &topology () const { return *reinterpret_cast<const wire_topology *> (p); }
+    /// @brief get a bus, if type () is WIRE_TOPOLOGY
+    const wire_bus &bus (size_t i) const { return reinterpret_cast<const wire_bus *> (p + topology ().bus_offset)[i]; }
+    /// @brief get a chip, if type () is WIRE_TOPOLOGY
+    const wire_chip &chip (size_t i) const { return reinterpret_cast<const wire_chip *> (p + topology ().chip_offset)[i]; }
+    /// @brief get temperature limits, if type () is WIRE_TOPOLOGY
+    const wire_limits &limits (size_t i) const { return reinterpret_cast<const wire_limits *> (p + topology ().limit_offset)[i]; }
+    /// @brief get a sensor label, if type () is WIRE_TOPOLOGY
+    const wire_label &label (size_t i) const { return reinterpret_cast<const wire_label *> (p + topology ().label_offset)[i]; }
+    /// @brief get the kind of an electrical reading, if type () is WIRE_TOPOLOGY
+    uint32_t kind (size_t i) const { return reinterpret_cast<const uint32_t *> (p + topology ().kind_offset)[i]; }
+    /// @brief get the values header, if type () is WIRE_VALUES
+    const wire_values &values () const { return *reinterpret_cast<const wire_values *> (p); }
+    /// @brief get the temperatures, if type () is WIRE_VALUES
+    const float *temps () const { return reinterpret_cast<const float *> (p + values ().temp_offset); }
+    /// @brief get the fan speeds, if type () is WIRE_VALUES
+    const float *fans () const { return reinterpret_cast<const float *> (p + values ().fan_offset); }
+    /// @brief get the electrical readings, if type () is WIRE_VALUES
+    const float *measurements () const { return reinterpret_cast<const float *> (p + values ().measurement_offset); }
+    /// @brief get the delta header, if type () is WIRE_DELTA
+    const wire_delta &delta () const { return *reinterpret_cast<const wire_delta *> (p); }
+    /// @brief get the indices of the changed values, if type () is WIRE_DELTA
+    const uint32_t *delta_indices () const { return reinterpret_cast<const uint32_t *> (p + delta ().index_offset); }
+    /// @brief get the changed values, if type () is WIRE_DELTA
+    const float *delta_values () const { return reinterpret_cast<const float *> (p + delta ().value_offset); }
+    /// @brief get the subscribe frame, if type () is WIRE_SUBSCRIBE
+    const wire_subscribe &subscribe () const { return *reinterpret_cast<const wire_subscribe *> (p); }
+    private:
+    const char *p;
+    bool valid;
+};
+
+/// @brief get the host name to put in topology frames
+///
+/// @return the name
+std::string get_host_name ();
+
+/// @brief append a topology frame to a buffer
+///
+/// @param bs vector of bus sensor data
+/// @param host host name
+/// @param buf the buffer
+///
+/// @return the topology id
+uint32_t encode_topology (const busses &bs, const std::string &host, std::vector<char> &buf);
+
+/// @brief append a values frame to a buffer
+///
+/// @param bs vector of bus sensor data
+/// @param topology_id id returned by encode_topology ()
+/// @param time sample time in ms since the epoch
+/// @param buf the buffer
+void encode_values (const busses &bs, uint32_t topology_id, uint64_t time, std::vector<char> &buf);
+
+/// @brief append a subscribe frame to a buffer
+///
+/// @param host host name
+/// @param buf the buffer
+void encode_subscribe (const std::string &host, std::vector<char> &buf);
+
+/// @brief get the host name in a subscribe frame
+///
+/// @param f the frame
+///
+/// @return the name
+std::string get_host (const frame_view &f);
+
+/// @brief fill a snapshot from a topology frame and a values frame
+///
+/// The snapshot's storage is reused.
+///
+/// @param t topology frame
+/// @param v values frame
+/// @param bs vector of bus sensor data
+///
+/// @return false if the frames don't belong together
+bool decode (const frame_view &t, const frame_view &v, busses &bs);
+
+/// @brief write a stream of frames
+///
+/// A topology frame is sent before the first values frame, and again only
+/// when the topology changes.
+class wire_encoder
+{
+    public:
+    /// @brief constructor
+    ///
+    /// @param host host name
+    wire_encoder (const std::string &host);
+    /// @brief append the frames for a snapshot to a buffer
+    ///
+    /// @param bs vector of bus sensor data
+    /// @param time sample time in ms since the epoch
+    /// @param buf the buffer
+    void encode (const busses &bs, uint64_t time, std::vector<char> &buf);
+    /// @brief append the frames for a snapshot to a buffer, sending only
+    /// the values that changed since the last snapshot
+    ///
+    /// A full values frame is sent with each topology frame.
+    ///
+    /// @param bs vector of bus sensor data
+    /// @param time sample time in ms since the epoch
+    /// @param buf the buffer
+    void encode_delta (const busses &bs, uint64_t time, std::vector<char> &buf);
+    /// @brief send the topology and all values with the next snapshot
+    void reset ();
+    private:
+    /// @brief encode the topology if it changed
+    ///
+    /// @return true if it changed
+    bool encode_topology (const busses &bs, std::vector<char> &buf);
+    std::string host;
+    /// @brief the last topology frame sent
+    std::vector<char> topology, tmp;
+    uint32_t topology_id;
+    /// @brief the last values sent by encode_delta ()
+    std::vector<float> last, current;
+    std::vector<uint32_t> changed;
+};
+
+/// @brief read a stream of frames
+class wire_decoder
+{
+    public:
+    /// @brief constructor
+    wire_decoder ();
+    /// @brief handle a frame
+    ///
+    /// Topology frames are copied and remembered.  Values and delta frames
+    /// are decoded into the snapshot.
+    ///
+    /// @param f the frame
+    /// @param bs vector of bus sensor data
+    ///
+    /// @return true if the snapshot was updated
+    bool decode (const frame_view &f, busses &bs);
+    /// @brief handle a frame without decoding it
+    ///
+    /// @param f the frame
+    ///
+    /// @return true if the values were updated
+    bool update (const frame_view &f);
+    /// @brief get the host name from the last topology frame
+    ///
+    /// @return the name
+    std::string get_host () const;
+    /// @brief get the time of the last values frame
+    ///
+    /// @return time in ms since the epoch
+    uint64_t get_time () const { return time; }
+    /// @brief get the last topology frame
+    ///
+    /// @return the frame, empty if none was received
+    const std::vector<char> &get_topology () const { return topology; }
+    /// @brief get the last values, with all deltas applied
+    ///
+    /// @return a values frame, empty if none was received
+    const std::vector<char> &get_values () const { return values; }
+    private:
+    std::vector<char> topology;
+    std::vector<char> values;
+    uint64_t time;
+};
+
+/// @brief split a byte stream into frames
+///
+/// Bytes are read into one buffer, and frames are handed out in place.
+/// Partial frames are moved to the front of the buffer, so frames always
+/// start on WIRE_ALIGNMENT boundaries.
+class frame_reader
+{
+    public:
+    /// @brief constructor
+    frame_reader ();
+    /// @brief read what is available from a descriptor
+    ///
+    /// @param fd the descriptor
+    ///
+    /// @return as for read(2)
+    ssize_t read (int fd);
+    /// @brief get the next complete frame
+    ///
+    /// The frame stays valid until the next call to read ().
+    ///
+    /// @return the frame's header, or nullptr if there is no complete frame
+    const wire_header *next ();
+    private:
+    /// @brief uint64_t elements keep the buffer aligned
+    std::vector<uint64_t> buf;
+    size_t begin, end;
+};
+
+} // namespace therm
+
+#endif